@@ -0,0 +1,55 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include "recompiler.hpp"
+
+void print_usage(const char *program_name)
+{
+  std::cerr << "Usage: " << program_name
+            << " PROGRAM_FILEPATH OUTPUT_FILEPATH" << std::endl
+            << std::endl
+            << "Recompile a program into a C++ translation unit. Build it as "
+               "a shared library"
+            << std::endl
+            << "and run it with chip8 --aot LIBRARY_FILEPATH." << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc != 3)
+  {
+    print_usage(argv[0]);
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::ifstream in(argv[1], std::ios::in | std::ios::binary);
+  if (!in)
+  {
+    std::cerr << "Could not open " << argv[1] << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  const std::vector<Chip8::byte_t> program(
+      (std::istreambuf_iterator<char>(in)),
+      std::istreambuf_iterator<char>());
+
+  const Chip8::Recompiler recompiler(program);
+
+  std::ofstream out(argv[2], std::ios::out | std::ios::trunc);
+  recompiler.emit(out);
+  if (!out)
+  {
+    std::cerr << "Could not write " << argv[2] << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::cout << recompiler.get_block_count() << " blocks, "
+            << recompiler.get_instruction_count() << " instructions, "
+            << recompiler.get_indirect_jump_count() << " indirect jumps"
+            << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,417 @@
+#include <cstdio>
+#include <string>
+
+#include "aot_module.hpp"
+#include "disassembler.hpp"
+#include "recompiler.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+std::string hex(unsigned value, int digits)
+{
+  char text[16];
+  std::snprintf(text, sizeof(text), "0x%0*X", digits, value);
+  return text;
+}
+
+std::string v(unsigned index)
+{
+  return "s.v_registers[" + hex(index, 1) + "]";
+}
+
+bool is_skip(dbyte_t opcode)
+{
+  switch (opcode & 0xF000)
+  {
+  case 0x3000:
+  case 0x4000:
+  case 0x5000:
+  case 0x9000:
+    return true;
+
+  case 0xE000:
+    return (opcode & 0xFF) == 0x9E || (opcode & 0xFF) == 0xA1;
+  }
+  return false;
+}
+
+/**
+ * Instructions after which a block has to end, because the control flow
+ * changes or because they write to memory, which may contain code.
+ */
+bool is_terminator(dbyte_t opcode)
+{
+  if (is_skip(opcode))
+  {
+    return true;
+  }
+
+  switch (opcode & 0xF000)
+  {
+  case 0x0000:
+    return opcode == 0x00EE;
+
+  case 0x1000:
+  case 0x2000:
+  case 0xB000:
+    return true;
+
+  case 0xF000:
+    return (opcode & 0xFF) == 0x0A || (opcode & 0xFF) == 0x33 ||
+           (opcode & 0xFF) == 0x55;
+  }
+  return false;
+}
+
+} // namespace
+
+Recompiler::Recompiler(const std::vector<byte_t> &program) : program(program)
+{
+  find_instructions();
+  build_blocks();
+}
+
+bool Recompiler::is_in_program(uint32_t address) const
+{
+  return address >= program_start &&
+         address + 1 < program_start + program.size();
+}
+
+dbyte_t Recompiler::get_opcode(dbyte_t address) const
+{
+  const uint32_t offset = address - program_start;
+  return program[offset] << 8 | program[offset + 1];
+}
+
+void Recompiler::find_instructions()
+{
+  std::vector<dbyte_t> work{program_start};
+  leaders.insert(program_start);
+
+  while (!work.empty())
+  {
+    const dbyte_t address = work.back();
+    work.pop_back();
+
+    if (!is_in_program(address) || instructions.count(address))
+    {
+      continue;
+    }
+    instructions.insert(address);
+
+    const dbyte_t opcode = get_opcode(address);
+    const dbyte_t next   = address + 2;
+
+    // Successors of the instruction. Like the interpreter, the program
+    // counter gets increased after jumps and calls.
+    std::vector<dbyte_t> successors;
+    if (opcode == 0x00EE)
+    {
+      // Returns land after the call, which is a leader already
+    }
+    else if ((opcode & 0xF000) == 0x1000)
+    {
+      successors = {dbyte_t((opcode & 0xFFF) + 2)};
+    }
+    else if ((opcode & 0xF000) == 0x2000)
+    {
+      successors = {dbyte_t((opcode & 0xFFF) + 2), next};
+    }
+    else if ((opcode & 0xF000) == 0xB000)
+    {
+      // The target depends on V0, the interpreter takes over
+      ++indirect_jumps;
+    }
+    else if (is_skip(opcode))
+    {
+      successors = {next, dbyte_t(next + 2)};
+    }
+    else
+    {
+      successors = {next};
+    }
+
+    for (const auto successor : successors)
+    {
+      if (is_terminator(opcode))
+      {
+        leaders.insert(successor);
+      }
+      work.push_back(successor);
+    }
+  }
+}
+
+void Recompiler::build_blocks()
+{
+  for (const auto leader : leaders)
+  {
+    if (!instructions.count(leader))
+    {
+      continue;
+    }
+
+    Block block{leader, {}};
+
+    dbyte_t address = leader;
+    for (;;)
+    {
+      const dbyte_t opcode = get_opcode(address);
+      block.opcodes.push_back(opcode);
+
+      if (is_terminator(opcode))
+      {
+        break;
+      }
+
+      address += 2;
+      if (!instructions.count(address) || leaders.count(address))
+      {
+        break;
+      }
+
+      if (block.opcodes.size() >= max_block_length)
+      {
+        // The rest gets a block of its own. It comes after this leader, so
+        // the loop still gets to it.
+        leaders.insert(address);
+        break;
+      }
+    }
+
+    blocks[leader] = block;
+  }
+}
+
+void Recompiler::emit(std::ostream &out) const
+{
+  out << "// Generated by chip8_aot. Do not edit.\n"
+         "\n"
+         "#include \"aot_module.hpp\"\n"
+         "\n"
+         "namespace\n"
+         "{\n"
+         "\n"
+         "using Chip8::AotRuntime;\n"
+         "using Chip8::Cpu;\n"
+         "using Chip8::CpuState;\n"
+         "using Chip8::dbyte_t;\n"
+         "\n"
+         "inline void tick(CpuState &s)\n"
+         "{\n"
+         "  if (s.timer_delay_register > 0)\n"
+         "  {\n"
+         "    --s.timer_delay_register;\n"
+         "  }\n"
+         "  if (s.sound_delay_register > 0)\n"
+         "  {\n"
+         "    --s.sound_delay_register;\n"
+         "  }\n"
+         "}\n";
+
+  for (const auto &entry : blocks)
+  {
+    emit_block(out, entry.second);
+  }
+
+  out << "\n";
+  if (blocks.empty())
+  {
+    out << "const Chip8::AotBlock *blocks = nullptr;\n";
+  }
+  else
+  {
+    out << "const Chip8::AotBlock blocks[] = {\n";
+    for (const auto &entry : blocks)
+    {
+      const Block &block = entry.second;
+      out << "    {" << hex(block.address, 3) << ", " << block.opcodes.size()
+          << ", " << hex(block.opcodes.back(), 4) << ", block_"
+          << hex(block.address, 3) << "},\n";
+    }
+    out << "};\n";
+  }
+
+  out << "\n"
+         "} // namespace\n"
+         "\n"
+         "extern \"C\" const Chip8::AotModule chip8_aot_module = {\n"
+      << "    Chip8::aot_module_version,\n"
+      << "    " << hex(hash_program(program), 8) << ",\n"
+      << "    " << program.size() << ",\n"
+      << "    " << blocks.size() << ",\n"
+      << "    blocks};\n";
+}
+
+void Recompiler::emit_block(std::ostream &out, const Block &block) const
+{
+  out << "\n"
+      << "void block_" << hex(block.address, 3)
+      << "(const AotRuntime &runtime, Cpu &cpu, CpuState &s)\n"
+      << "{\n"
+      << "  (void)runtime;\n"
+      << "  (void)cpu;\n";
+
+  dbyte_t address = block.address;
+  for (size_t i = 0; i < block.opcodes.size(); ++i)
+  {
+    emit_instruction(out, address, block.opcodes[i]);
+    address += 2;
+  }
+
+  if (!is_terminator(block.opcodes.back()))
+  {
+    out << "  s.pc_register = " << hex(address, 3) << ";\n";
+  }
+
+  out << "}\n";
+}
+
+void Recompiler::emit_instruction(std::ostream &out,
+                                  dbyte_t       address,
+                                  dbyte_t       opcode) const
+{
+  const unsigned addr = opcode & 0xFFF;
+  const unsigned x    = (opcode & 0x0F00) >> 8;
+  const unsigned y    = (opcode & 0x00F0) >> 4;
+  const unsigned nn   = opcode & 0xFF;
+
+  const std::string next = hex(address + 2, 3);
+
+  out << "\n  // " << hex(address, 3) << ": " << hex(opcode, 4) << "  "
+      << disassemble(opcode) << "\n";
+
+  // Everything that is not simple enough to inline runs through the
+  // interpreter, so that the semantics stay exactly the same
+  bool use_interpreter = false;
+
+  switch (opcode & 0xF000)
+  {
+  case 0x0000:
+    if (opcode == 0x00E0)
+    {
+      out << "  s.framebuffer = {};\n";
+    }
+    else if (opcode == 0x00EE)
+    {
+      out << "  s.pc_register = s.stack[--s.sp_register & 0xF] + 2;\n";
+    }
+    break;
+
+  case 0x1000:
+    out << "  s.pc_register = " << hex(addr + 2, 3) << ";\n";
+    break;
+
+  case 0x2000:
+    out << "  s.stack[s.sp_register++ & 0xF] = " << hex(address, 3) << ";\n"
+        << "  s.pc_register = " << hex(addr + 2, 3) << ";\n";
+    break;
+
+  case 0x3000:
+  case 0x4000:
+    out << "  s.pc_register = " << v(x)
+        << ((opcode & 0xF000) == 0x3000 ? " == " : " != ") << hex(nn, 2)
+        << " ? " << hex(address + 4, 3) << " : " << next << ";\n";
+    break;
+
+  case 0x5000:
+  case 0x9000:
+    out << "  s.pc_register = " << v(x)
+        << ((opcode & 0xF000) == 0x5000 ? " == " : " != ") << v(y) << " ? "
+        << hex(address + 4, 3) << " : " << next << ";\n";
+    break;
+
+  case 0x6000:
+    out << "  " << v(x) << " = " << hex(nn, 2) << ";\n";
+    break;
+
+  case 0x7000:
+    out << "  " << v(x) << " += " << hex(nn, 2) << ";\n";
+    break;
+
+  case 0x8000:
+    switch (opcode & 0xF)
+    {
+    case 0x0:
+      out << "  " << v(x) << " = " << v(y) << ";\n";
+      break;
+
+    case 0x1:
+      out << "  " << v(x) << " |= " << v(y) << ";\n";
+      break;
+
+    case 0x2:
+      out << "  " << v(x) << " &= " << v(y) << ";\n";
+      break;
+
+    case 0x3:
+      out << "  " << v(x) << " ^= " << v(y) << ";\n";
+      break;
+
+    default:
+      use_interpreter = true;
+      break;
+    }
+    break;
+
+  case 0xA000:
+    out << "  s.i_register = " << hex(addr, 3) << ";\n";
+    break;
+
+  case 0xB000:
+    out << "  s.pc_register = " << hex(addr, 3) << " + " << v(0) << " + 2;\n";
+    break;
+
+  case 0xF000:
+    switch (nn)
+    {
+    case 0x07:
+      out << "  " << v(x) << " = s.timer_delay_register;\n";
+      break;
+
+    case 0x15:
+      out << "  s.timer_delay_register = " << v(x) << ";\n";
+      break;
+
+    case 0x18:
+      out << "  s.sound_delay_register = " << v(x) << ";\n";
+      break;
+
+    case 0x1E:
+      out << "  s.i_register += " << v(x) << ";\n";
+      break;
+
+    case 0x29:
+      out << "  s.i_register = " << v(x) << " * 5;\n";
+      break;
+
+    default:
+      use_interpreter = true;
+      break;
+    }
+    break;
+
+  default:
+    use_interpreter = true;
+    break;
+  }
+
+  if (use_interpreter)
+  {
+    out << "  s.pc_register = " << hex(address, 3) << ";\n"
+        << "  runtime.execute_instruction(cpu, " << hex(opcode, 4) << ");\n";
+
+    if (is_terminator(opcode))
+    {
+      out << "  s.pc_register += 2;\n";
+    }
+  }
+
+  out << "  tick(s);\n";
+}
+
+} // namespace Chip8
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <vector>
+
+#include "cpu_state.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief Translates a program into C++ ahead of time.
+ *
+ * Starting at the entry point the control flow graph is recovered by
+ * following all direct jumps, calls and skips. Every basic block becomes
+ * a C++ function operating on the CpuState. The emitted translation unit
+ * exports a AotModule that can be run by the AotEngine.
+ *
+ * The recompiled code has to behave exactly like the interpreter, including
+ * its quirks: after a jump the program counter is increased once more, so
+ * the instruction at the target address is skipped.
+ */
+class Recompiler
+{
+public:
+  explicit Recompiler(const std::vector<byte_t> &program);
+
+  /**
+   * Write the translation unit.
+   */
+  void emit(std::ostream &out) const;
+
+  uint32_t get_block_count() const { return blocks.size(); }
+
+  uint32_t get_instruction_count() const { return instructions.size(); }
+
+  uint32_t get_indirect_jump_count() const { return indirect_jumps; }
+
+private:
+  const dbyte_t program_start = 0x200;
+
+  /**
+   * Upper limit of instructions per block.
+   */
+  const uint32_t max_block_length = 256;
+
+  struct Block
+  {
+    dbyte_t              address{};
+    std::vector<dbyte_t> opcodes{};
+  };
+
+  const std::vector<byte_t> &program;
+
+  std::set<dbyte_t>        instructions{};
+  std::set<dbyte_t>        leaders{};
+  std::map<dbyte_t, Block> blocks{};
+
+  uint32_t indirect_jumps = 0;
+
+  bool is_in_program(uint32_t address) const;
+
+  dbyte_t get_opcode(dbyte_t address) const;
+
+  void find_instructions();
+
+  void build_blocks();
+
+  void emit_block(std::ostream &out, const Block &block) const;
+
+  void
+  emit_instruction(std::ostream &out, dbyte_t address, dbyte_t opcode) const;
+};
+
+} // namespace Chip8
@@ -1,26 +1,255 @@
+#include <cmath>
+#include <csignal>
 #include <cstdlib>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
+#include "server.hpp"
 #include "simulator.hpp"
 
+Chip8::Server *server = nullptr;
+
+void stop_server(int /*signal*/) { server->stop(); }
+
+/**
+ * Parse the --speed argument, a positive multiple or max for 0.
+ *
+ * @return false if it is neither
+ */
+bool parse_speed(const std::string &text, double &speed)
+{
+  if (text == "max")
+  {
+    speed = 0.0;
+    return true;
+  }
+
+  try
+  {
+    size_t end = 0;
+    speed      = std::stod(text, &end);
+    return end == text.size() && speed > 0.0 && std::isfinite(speed);
+  }
+  catch (const std::logic_error &)
+  {
+    return false;
+  }
+}
+
+/**
+ * Frames run-ahead may run ahead at most. Every presented frame costs N + 1
+ * emulated frames, and more than a quarter of a second is no lag to hide.
+ */
+constexpr uint32_t max_run_ahead_frames = 16;
+
+/**
+ * Parse the --run-ahead argument, a number of frames up to
+ * max_run_ahead_frames.
+ *
+ * @return false if it is no such number
+ */
+bool parse_run_ahead(const std::string &text, uint32_t &frames)
+{
+  // std::stoul would take signs, blanks and trailing garbage
+  if (text.empty() || text.size() > 3 ||
+      text.find_first_not_of("0123456789") != std::string::npos)
+  {
+    return false;
+  }
+
+  frames = std::stoul(text);
+  return frames <= max_run_ahead_frames;
+}
+
 void print_usage(const char *program_name)
 {
-  std::cerr << "Usage: " << program_name << " [PROGRAM_FILEPATH]" << std::endl;
+  std::cerr << "Usage: " << program_name << " [OPTIONS] [PROGRAM_FILEPATH]"
+            << std::endl
+            << std::endl
+            << "Options:" << std::endl
+            << "  --capture FILEPATH  Record all frames. The format is picked "
+               "by the file"
+            << std::endl
+            << "                      extension: .y4m, .raw or .png (one file "
+               "per frame)"
+            << std::endl
+            << "  --speed N|max       Start in turbo mode running at N times "
+               "the normal"
+            << std::endl
+            << "                      speed or as fast as possible. Tab "
+               "toggles turbo mode"
+            << std::endl
+            << "  --run-ahead N       Present frames N frames ahead to "
+               "reduce input lag, N at"
+            << std::endl
+            << "                      most " << max_run_ahead_frames
+            << std::endl
+            << "  --aot FILEPATH      Run code recompiled by chip8_aot from "
+               "a shared library"
+            << std::endl
+            << "  --fusion            Execute common instruction sequences "
+               "as one"
+            << std::endl
+            << "  --debug             Start paused under a debugger "
+               "controlled from stdin"
+            << std::endl
+            << "  --trace FILEPATH    Record every executed instruction, "
+               "print with chip8_trace"
+            << std::endl
+            << "  --watch             Reload the program when its file "
+               "changes, keeping the"
+            << std::endl
+            << "                      registers and the rest of memory"
+            << std::endl
+            << "  --serve SOCKET      Run headless and serve sessions on a "
+               "Unix domain socket"
+            << std::endl;
 }
 
 int main(int argc, char *argv[])
 {
-  if (argc != 2)
+  std::string program_filepath;
+  std::string capture_filepath;
+  double      speed = -1.0;
+  uint32_t    run_ahead_frames = 0;
+  std::string aot_filepath;
+  bool        fusion = false;
+  bool        watch  = false;
+  bool        debug  = false;
+  std::string socket_path;
+  std::string trace_filepath;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+
+    if (arg == "--capture" && i + 1 < argc)
+    {
+      capture_filepath = argv[++i];
+    }
+    else if (arg == "--speed" && i + 1 < argc)
+    {
+      if (!parse_speed(argv[++i], speed))
+      {
+        std::cerr << "Invalid speed: " << argv[i] << std::endl;
+        print_usage(argv[0]);
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    else if (arg == "--run-ahead" && i + 1 < argc)
+    {
+      if (!parse_run_ahead(argv[++i], run_ahead_frames))
+      {
+        std::cerr << "Invalid number of run-ahead frames: " << argv[i]
+                  << std::endl;
+        print_usage(argv[0]);
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    else if (arg == "--aot" && i + 1 < argc)
+    {
+      aot_filepath = argv[++i];
+    }
+    else if (arg == "--fusion")
+    {
+      fusion = true;
+    }
+    else if (arg == "--debug")
+    {
+      debug = true;
+    }
+    else if (arg == "--watch")
+    {
+      watch = true;
+    }
+    else if (arg == "--trace" && i + 1 < argc)
+    {
+      trace_filepath = argv[++i];
+    }
+    else if (arg == "--serve" && i + 1 < argc)
+    {
+      socket_path = argv[++i];
+    }
+    else if (program_filepath.empty() && arg.rfind("--", 0) != 0)
+    {
+      program_filepath = arg;
+    }
+    else
+    {
+      print_usage(argv[0]);
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if (!socket_path.empty())
+  {
+    Chip8::Server socket_server(socket_path);
+
+    server = &socket_server;
+    std::signal(SIGINT, stop_server);
+    std::signal(SIGTERM, stop_server);
+
+    socket_server.run();
+    return 0;
+  }
+
+  if (program_filepath.empty())
   {
     print_usage(argv[0]);
     std::exit(EXIT_FAILURE);
   }
 
+  if (debug && !trace_filepath.empty())
+  {
+    std::cerr << "--debug and --trace can not be combined" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
   Chip8::Simulator simulator;
 
-  const auto program_filepath = argv[1];
   simulator.load_program(program_filepath);
 
+  if (watch)
+  {
+    simulator.watch_program();
+  }
+
+  if (fusion)
+  {
+    simulator.enable_fusion();
+  }
+
+  if (!aot_filepath.empty())
+  {
+    simulator.load_aot_module(aot_filepath);
+  }
+
+  if (debug)
+  {
+    simulator.attach_debugger();
+  }
+
+  if (!trace_filepath.empty())
+  {
+    simulator.start_trace(trace_filepath);
+  }
+
+  if (!capture_filepath.empty())
+  {
+    simulator.start_capture(
+        capture_filepath,
+        Chip8::FrameRecorder::format_from_path(capture_filepath));
+  }
+
+  if (speed >= 0.0)
+  {
+    simulator.set_turbo_speed(speed);
+    simulator.set_turbo(true);
+  }
+
+  simulator.set_run_ahead(run_ahead_frames);
+
   simulator.execute();
 
   simulator.terminate();
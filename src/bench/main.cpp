@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cpu.hpp"
+#include "headless_keyboard.hpp"
+#include "machine_pool.hpp"
+
+void print_usage(const char *program_name)
+{
+  std::cerr << "Usage: " << program_name << " [OPTIONS] [PROGRAM_FILEPATH...]"
+            << std::endl
+            << std::endl
+            << "Measure the speed of the interpreter on a built in program "
+               "that draws, stores"
+            << std::endl
+            << "and loads all the time, and on the given programs."
+            << std::endl
+            << std::endl
+            << "Options:" << std::endl
+            << "  --cycles N          Cycles per run (default 20000000)"
+            << std::endl
+            << "  --runs N            Runs per program, the fastest counts "
+               "(default 5)"
+            << std::endl
+            << "  --instances N       Machines to create for measuring "
+               "creation (default 100000)"
+            << std::endl;
+}
+
+/**
+ * Loops over the instructions that access memory through I, moving I
+ * across most of memory.
+ */
+const std::vector<Chip8::byte_t> memory_program = {
+    0x61, 0x00, // 200: LD V1, 0x00
+    0x62, 0x00, // 202: LD V2, 0x00
+    0xAE, 0x00, // 204: LD I, 0xE00
+    0xF0, 0x1E, // 206: ADD I, V0
+    0xD1, 0x2F, // 208: DRW V1, V2, 15
+    0xF3, 0x33, // 20A: LD B, V3
+    0xFF, 0x55, // 20C: LD [I], VF
+    0xFF, 0x65, // 20E: LD VF, [I]
+    0x70, 0x01, // 210: ADD V0, 0x01
+    0x73, 0x07, // 212: ADD V3, 0x07
+    0x71, 0x03, // 214: ADD V1, 0x03
+    0x12, 0x02, // 216: JP 0x202, continues at 0x204
+};
+
+std::vector<Chip8::byte_t> load_program(const std::string &filepath)
+{
+  std::ifstream in(filepath, std::ios::in | std::ios::binary);
+  if (!in)
+  {
+    throw std::runtime_error("Could not open " + filepath);
+  }
+
+  return std::vector<Chip8::byte_t>((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+}
+
+/**
+ * @return Cycles per second of the fastest run
+ */
+double measure(const std::vector<Chip8::byte_t> &program,
+               uint64_t                          cycles,
+               uint32_t                          runs)
+{
+  double best = 0.0;
+
+  for (uint32_t run = 0; run < runs; ++run)
+  {
+    Chip8::Cpu cpu(std::make_unique<Chip8::HeadlessKeyboard>());
+    cpu.init();
+    cpu.load_program(program);
+
+    Chip8::CpuState state = cpu.get_state();
+    state.random_engine.seed(0);
+    cpu.set_state(state);
+
+    const auto start = std::chrono::steady_clock::now();
+    cpu.run(cycles);
+    const auto finish = std::chrono::steady_clock::now();
+
+    best = std::max(
+        best, cycles / std::chrono::duration<double>(finish - start).count());
+  }
+
+  return best;
+}
+
+/**
+ * Create machines for the program one after the other, as Cpu objects and
+ * from a MachinePool, and let each run a few cycles.
+ *
+ * @return Machines per second of the fastest run, for Cpu and for the pool
+ */
+std::pair<double, double>
+measure_instances(const std::vector<Chip8::byte_t> &program,
+                  uint32_t                          instances,
+                  uint32_t                          runs)
+{
+  constexpr uint32_t cycles = 16;
+
+  double best_cpu  = 0.0;
+  double best_pool = 0.0;
+
+  for (uint32_t run = 0; run < runs; ++run)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < instances; ++i)
+    {
+      Chip8::Cpu cpu(std::make_unique<Chip8::HeadlessKeyboard>());
+      cpu.init();
+      cpu.load_program(program);
+      cpu.run(cycles);
+    }
+    auto finish = std::chrono::steady_clock::now();
+
+    best_cpu = std::max(
+        best_cpu,
+        instances / std::chrono::duration<double>(finish - start).count());
+
+    Chip8::MachinePool pool(program, 64);
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < instances; ++i)
+    {
+      Chip8::Machine *machine = pool.acquire();
+      machine->run(cycles);
+      pool.release(machine);
+    }
+    finish = std::chrono::steady_clock::now();
+
+    best_pool = std::max(
+        best_pool,
+        instances / std::chrono::duration<double>(finish - start).count());
+  }
+
+  return {best_cpu, best_pool};
+}
+
+int main(int argc, char *argv[])
+{
+  uint64_t                 cycles    = 20000000;
+  uint32_t                 runs      = 5;
+  uint32_t                 instances = 100000;
+  std::vector<std::string> program_filepaths;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+
+    if (arg == "--cycles" && i + 1 < argc)
+    {
+      cycles = std::stoull(argv[++i]);
+    }
+    else if (arg == "--runs" && i + 1 < argc)
+    {
+      runs = std::max(1ul, std::stoul(argv[++i]));
+    }
+    else if (arg == "--instances" && i + 1 < argc)
+    {
+      instances = std::stoul(argv[++i]);
+    }
+    else if (arg.rfind("--", 0) != 0)
+    {
+      program_filepaths.push_back(arg);
+    }
+    else
+    {
+      print_usage(argv[0]);
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  std::vector<std::pair<std::string, std::vector<Chip8::byte_t>>> programs;
+  programs.emplace_back("(memory access loop)", memory_program);
+
+  try
+  {
+    for (const auto &filepath : program_filepaths)
+    {
+      programs.emplace_back(filepath, load_program(filepath));
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  for (const auto &program : programs)
+  {
+    std::cout << program.first << ": "
+              << measure(program.second, cycles, runs) / 1000000.0
+              << " Mcycles/s" << std::endl;
+  }
+
+  const auto created = measure_instances(memory_program, instances, runs);
+  std::cout << "Machines created: " << created.first << "/s as Cpu, "
+            << created.second << "/s from a MachinePool" << std::endl;
+
+  return EXIT_SUCCESS;
+}
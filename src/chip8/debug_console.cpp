@@ -0,0 +1,236 @@
+#include <cstdio>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "debug_console.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+const char *const help =
+    "b ADDR               Set a breakpoint\n"
+    "bd ADDR              Delete a breakpoint\n"
+    "w ADDR [SIZE] [r|w]  Watch reads and/or writes, both if not given\n"
+    "wd ADDR [SIZE]       Delete a watchpoint\n"
+    "if REG OP VALUE      Stop when the condition turns true, e.g. "
+    "if V3 == 0x10\n"
+    "                     REG is V0-VF, I, DT or ST, OP one of "
+    "== != < <= > >=\n"
+    "ifd N                Delete condition N\n"
+    "c                    Continue\n"
+    "p                    Pause\n"
+    "s [N]                Step N instructions, 1 if not given\n"
+    "f                    Step a frame\n"
+    "r                    Show the registers and code\n"
+    "d [N]                Disassemble N instructions from the program "
+    "counter\n"
+    "l                    List breakpoints, watchpoints and conditions\n"
+    "Addresses are in hex. F5 continues or pauses, F10 steps and F11 steps "
+    "a frame.\n";
+
+dbyte_t parse_address(const std::string &text)
+{
+  return std::stoul(text, nullptr, 16);
+}
+
+} // namespace
+
+DebugConsole::DebugConsole(Debugger &debugger, const Cpu &cpu)
+    : debugger(debugger), cpu(cpu)
+{
+  std::cout << "Debugger attached, type h for help" << std::endl;
+  show();
+}
+
+void DebugConsole::update()
+{
+  pollfd stdin_poll{STDIN_FILENO, POLLIN, 0};
+  while (!input_closed && ::poll(&stdin_poll, 1, 0) > 0)
+  {
+    char          buffer[256];
+    const ssize_t length = read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (length <= 0)
+    {
+      input_closed = true;
+      break;
+    }
+    input.append(buffer, length);
+
+    size_t end;
+    while ((end = input.find('\n')) != std::string::npos)
+    {
+      const std::string line = input.substr(0, end);
+      input.erase(0, end + 1);
+
+      try
+      {
+        execute(line);
+      }
+      catch (const std::exception &e)
+      {
+        std::cout << e.what() << std::endl;
+      }
+    }
+  }
+
+  if (debugger.get_stop_count() != shown_stops && debugger.is_stopped())
+  {
+    show();
+  }
+}
+
+void DebugConsole::execute(const std::string &line)
+{
+  std::istringstream in(line);
+
+  std::string command;
+  if (!(in >> command))
+  {
+    return;
+  }
+
+  std::string first;
+  std::string second;
+  std::string third;
+  in >> first >> second >> third;
+
+  if (command == "b" && !first.empty())
+  {
+    debugger.set_breakpoint(parse_address(first), true);
+  }
+  else if (command == "bd" && !first.empty())
+  {
+    debugger.set_breakpoint(parse_address(first), false);
+  }
+  else if (command == "w" && !first.empty())
+  {
+    // The size is optional, an access has no digits that could be hex
+    if (second == "r" || second == "w" || second == "rw")
+    {
+      third = second;
+      second.clear();
+    }
+
+    const uint32_t size = second.empty() ? 1 : std::stoul(second, nullptr, 0);
+
+    byte_t access = 0;
+    if (third.empty() || third.find('r') != std::string::npos)
+    {
+      access |= Debugger::watch_read;
+    }
+    if (third.empty() || third.find('w') != std::string::npos)
+    {
+      access |= Debugger::watch_write;
+    }
+    debugger.set_watchpoint(parse_address(first), size, access);
+  }
+  else if (command == "wd" && !first.empty())
+  {
+    const uint32_t size = second.empty() ? 1 : std::stoul(second, nullptr, 0);
+    debugger.set_watchpoint(parse_address(first), size, 0);
+  }
+  else if (command == "if")
+  {
+    debugger.add_condition(
+        parse_register_condition(line.substr(line.find("if") + 2)));
+  }
+  else if (command == "ifd" && !first.empty())
+  {
+    debugger.remove_condition(std::stoul(first));
+  }
+  else if (command == "c")
+  {
+    debugger.resume();
+  }
+  else if (command == "p")
+  {
+    debugger.pause();
+  }
+  else if (command == "s")
+  {
+    debugger.step(first.empty() ? 1 : std::stoul(first));
+  }
+  else if (command == "f")
+  {
+    debugger.step_frame();
+  }
+  else if (command == "r")
+  {
+    show();
+  }
+  else if (command == "d")
+  {
+    const uint32_t count = first.empty() ? 16 : std::stoul(first);
+    std::cout << debugger.disassemble_around(cpu.get_state(), 0,
+                                             count > 0 ? count - 1 : 0)
+              << std::flush;
+  }
+  else if (command == "l")
+  {
+    list();
+  }
+  else
+  {
+    std::cout << help << std::flush;
+  }
+}
+
+void DebugConsole::show()
+{
+  shown_stops = debugger.get_stop_count();
+
+  std::cout << debugger.describe_stop() << std::endl
+            << format_registers(cpu.get_state())
+            << debugger.disassemble_around(cpu.get_state(), 3, 6)
+            << std::flush;
+}
+
+void DebugConsole::list()
+{
+  char text[48];
+
+  std::cout << "Breakpoints:";
+  for (const dbyte_t address : debugger.get_breakpoints())
+  {
+    std::snprintf(text, sizeof(text), " 0x%03X", address);
+    std::cout << text;
+  }
+  std::cout << std::endl << "Watchpoints:";
+
+  // Runs of bytes with the same access are listed as one
+  const auto &watched = debugger.get_watchpoints();
+  for (uint32_t address = 0; address < memory_size;)
+  {
+    const byte_t access = watched[address];
+    uint32_t     end    = address + 1;
+    while (end < memory_size && watched[end] == access)
+    {
+      ++end;
+    }
+
+    if (access)
+    {
+      std::snprintf(text, sizeof(text), " 0x%03X+%u %s%s", address,
+                    end - address, access & Debugger::watch_read ? "r" : "",
+                    access & Debugger::watch_write ? "w" : "");
+      std::cout << text;
+    }
+    address = end;
+  }
+  std::cout << std::endl;
+
+  const auto &conditions = debugger.get_conditions();
+  for (size_t i = 0; i < conditions.size(); ++i)
+  {
+    std::cout << "Condition " << i << ": " << to_string(conditions[i])
+              << std::endl;
+  }
+}
+
+} // namespace Chip8
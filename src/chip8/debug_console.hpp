@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "cpu.hpp"
+#include "debugger.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief Controls a debugger with commands typed on stdin while the
+ * simulator runs.
+ *
+ * Whenever the machine stops the registers and the code around the program
+ * counter get printed. Type h for a list of the commands.
+ */
+class DebugConsole
+{
+public:
+  DebugConsole(Debugger &debugger, const Cpu &cpu);
+
+  /**
+   * Execute the commands typed since the last call and show a new stop.
+   * Never blocks.
+   */
+  void update();
+
+  /**
+   * Execute a single command line.
+   */
+  void execute(const std::string &line);
+
+private:
+  Debugger  &debugger;
+  const Cpu &cpu;
+
+  /**
+   * Input that does not form a complete line yet.
+   */
+  std::string input{};
+  bool        input_closed = false;
+
+  uint64_t shown_stops = 0;
+
+  void show();
+
+  void list();
+};
+
+} // namespace Chip8
@@ -0,0 +1,66 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "file_watcher.hpp"
+
+namespace Chip8
+{
+
+FileWatcher::FileWatcher(const std::string &filepath)
+{
+  const size_t slash = filepath.rfind('/');
+
+  const std::string directory =
+      slash == std::string::npos ? "." : filepath.substr(0, slash + 1);
+  name = slash == std::string::npos ? filepath : filepath.substr(slash + 1);
+
+  fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0)
+  {
+    throw std::runtime_error(std::string("Could not init inotify: ") +
+                             std::strerror(errno));
+  }
+
+  // A write is complete on close, a replacement arrives by rename
+  if (inotify_add_watch(fd, directory.c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+  {
+    const std::string error = std::strerror(errno);
+    close(fd);
+    throw std::runtime_error("Could not watch " + directory + ": " + error);
+  }
+}
+
+FileWatcher::~FileWatcher() { close(fd); }
+
+bool FileWatcher::poll()
+{
+  bool changed = false;
+
+  alignas(inotify_event) char buffer[4096];
+  for (;;)
+  {
+    const ssize_t length = read(fd, buffer, sizeof(buffer));
+    if (length <= 0)
+    {
+      return changed;
+    }
+
+    for (ssize_t offset = 0; offset < length;)
+    {
+      const auto *event =
+          reinterpret_cast<const inotify_event *>(&buffer[offset]);
+      offset += sizeof(inotify_event) + event->len;
+
+      if (event->len > 0 && name == event->name)
+      {
+        changed = true;
+      }
+    }
+  }
+}
+
+} // namespace Chip8
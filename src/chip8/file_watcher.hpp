@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+
+namespace Chip8
+{
+
+/**
+ * @brief Notices when a file on disk gets rewritten, using inotify.
+ *
+ * The directory of the file is watched rather than the file itself. Many
+ * editors and assemblers save by writing a new file and renaming it over
+ * the old one, which a watch on the old file would never see.
+ */
+class FileWatcher
+{
+public:
+  /**
+   * Throws a exception if the directory of the file can not be watched.
+   */
+  explicit FileWatcher(const std::string &filepath);
+
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher &) = delete;
+  FileWatcher &operator=(const FileWatcher &) = delete;
+
+  /**
+   * Never blocks. Several writes since the last call count as one change.
+   *
+   * @return true if the file was written or replaced since the last call
+   */
+  bool poll();
+
+private:
+  /**
+   * Name of the file within the watched directory.
+   */
+  std::string name;
+
+  int fd = -1;
+};
+
+} // namespace Chip8
@@ -0,0 +1,341 @@
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "frame_recorder.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+uint32_t next_power_of_two(uint32_t value)
+{
+  uint32_t result = 1;
+  while (result < value)
+  {
+    result <<= 1;
+  }
+  return result;
+}
+
+std::array<uint32_t, 256> make_crc_table()
+{
+  std::array<uint32_t, 256> table{};
+  for (uint32_t n = 0; n < table.size(); ++n)
+  {
+    uint32_t c = n;
+    for (int k = 0; k < 8; ++k)
+    {
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+    table[n] = c;
+  }
+  return table;
+}
+
+uint32_t crc32(const std::string &data)
+{
+  static const auto table = make_crc_table();
+
+  uint32_t c = 0xFFFFFFFFu;
+  for (const unsigned char byte : data)
+  {
+    c = table[(c ^ byte) & 0xFF] ^ (c >> 8);
+  }
+  return c ^ 0xFFFFFFFFu;
+}
+
+void append_be32(std::string &out, uint32_t value)
+{
+  out.push_back(static_cast<char>(value >> 24));
+  out.push_back(static_cast<char>(value >> 16));
+  out.push_back(static_cast<char>(value >> 8));
+  out.push_back(static_cast<char>(value));
+}
+
+void write_png_chunk(std::ofstream &out, const char *type, std::string data)
+{
+  std::string chunk(type);
+  chunk += data;
+
+  std::string length;
+  append_be32(length, data.size());
+  std::string crc;
+  append_be32(crc, crc32(chunk));
+
+  out << length << chunk << crc;
+}
+
+} // namespace
+
+FrameRecorder::IndexRing::IndexRing(uint32_t capacity)
+    : slots(next_power_of_two(capacity)),
+      mask(slots.size() - 1)
+{
+}
+
+bool FrameRecorder::IndexRing::push(uint32_t index)
+{
+  const uint32_t current_tail = tail.load(std::memory_order_relaxed);
+  if (current_tail - head.load(std::memory_order_acquire) == slots.size())
+  {
+    return false;
+  }
+
+  slots[current_tail & mask] = index;
+  tail.store(current_tail + 1, std::memory_order_release);
+  return true;
+}
+
+bool FrameRecorder::IndexRing::pop(uint32_t &index)
+{
+  const uint32_t current_head = head.load(std::memory_order_relaxed);
+  if (current_head == tail.load(std::memory_order_acquire))
+  {
+    return false;
+  }
+
+  index = slots[current_head & mask];
+  head.store(current_head + 1, std::memory_order_release);
+  return true;
+}
+
+FrameRecorder::FrameRecorder(const std::string &path,
+                             CaptureFormat      format,
+                             uint32_t           pool_size)
+    : path(path),
+      format(format),
+      frames(std::make_unique<Frame[]>(pool_size)),
+      free_frames(pool_size),
+      queued_frames(pool_size)
+{
+  for (uint32_t i = 0; i < pool_size; ++i)
+  {
+    free_frames.push(i);
+  }
+
+  if (format != CaptureFormat::Png)
+  {
+    out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+      throw std::runtime_error("Could not open capture file " + path);
+    }
+  }
+
+  if (format == CaptureFormat::Y4m)
+  {
+    out << "YUV4MPEG2 W" << display_width << " H" << display_height
+        << " F60:1 Ip A1:1 Cmono\n";
+  }
+
+  encoder_thread = std::thread(&FrameRecorder::encode_loop, this);
+}
+
+FrameRecorder::~FrameRecorder() { stop(); }
+
+bool FrameRecorder::capture(const Framebuffer &framebuffer)
+{
+  const uint64_t number = frame_number++;
+
+  uint32_t index;
+  if (!free_frames.pop(index))
+  {
+    ++dropped_frames;
+    return false;
+  }
+
+  frames[index].number = number;
+  frames[index].pixels = framebuffer;
+
+  // Both rings are as big as the pool, so this can not fail
+  queued_frames.push(index);
+  wake.notify_one();
+
+  return true;
+}
+
+void FrameRecorder::stop()
+{
+  if (!encoder_thread.joinable())
+  {
+    return;
+  }
+
+  running = false;
+  wake.notify_one();
+  encoder_thread.join();
+
+  out.close();
+}
+
+CaptureFormat FrameRecorder::format_from_path(const std::string &path)
+{
+  const auto ends_with = [&path](const std::string &suffix) {
+    return path.size() >= suffix.size() &&
+           path.compare(path.size() - suffix.size(), suffix.size(), suffix) ==
+               0;
+  };
+
+  if (ends_with(".png"))
+  {
+    return CaptureFormat::Png;
+  }
+  if (ends_with(".raw"))
+  {
+    return CaptureFormat::Raw;
+  }
+  return CaptureFormat::Y4m;
+}
+
+void FrameRecorder::encode_loop()
+{
+  for (;;)
+  {
+    // Read before draining: stop() runs after the last capture(), so once
+    // running was seen cleared the queue gets emptied one last time
+    const bool was_running = running;
+
+    uint32_t index;
+    while (queued_frames.pop(index))
+    {
+      if (write_frame(frames[index]))
+      {
+        ++written_frames;
+      }
+      else
+      {
+        ++failed_frames;
+      }
+      free_frames.push(index);
+    }
+
+    if (!was_running)
+    {
+      return;
+    }
+
+    // The producer notifies without taking the lock, so a wake up can get
+    // lost. The timeout bounds the latency in that case.
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    wake.wait_for(lock, std::chrono::milliseconds(5));
+  }
+}
+
+bool FrameRecorder::write_frame(const Frame &frame)
+{
+  std::array<char, display_width> row_data{};
+
+  switch (format)
+  {
+  case CaptureFormat::Y4m:
+    out << "FRAME\n";
+    [[fallthrough]];
+
+  case CaptureFormat::Raw:
+    for (const auto &row : frame.pixels)
+    {
+      for (uint32_t x = 0; x < display_width; ++x)
+      {
+        row_data[x] = row[x] ? static_cast<char>(0xFF) : 0;
+      }
+      out.write(row_data.data(), row_data.size());
+    }
+    break;
+
+  case CaptureFormat::Png:
+    return write_png(frame);
+  }
+
+  if (!out)
+  {
+    if (error.empty())
+    {
+      error = "Could not write " + path;
+    }
+    return false;
+  }
+  return true;
+}
+
+bool FrameRecorder::write_png(const Frame &frame)
+{
+  std::string file_path = path;
+  if (file_path.size() >= 4)
+  {
+    file_path.erase(file_path.size() - 4);
+  }
+
+  std::ostringstream name;
+  name << file_path << '_' << std::setw(6) << std::setfill('0') << frame.number
+       << ".png";
+
+  std::ofstream png(name.str(), std::ios::out | std::ios::binary);
+  if (!png)
+  {
+    if (error.empty())
+    {
+      error = "Could not open " + name.str();
+    }
+    return false;
+  }
+
+  png << "\x89PNG\r\n\x1a\n";
+
+  // 8 bit grayscale, no interlacing
+  std::string header;
+  append_be32(header, display_width);
+  append_be32(header, display_height);
+  header += std::string("\x08\x00\x00\x00\x00", 5);
+  write_png_chunk(png, "IHDR", header);
+
+  // Scanlines with filter type 0, stored in a single uncompressed deflate
+  // block. The frame is tiny, so compressing is not worth the cpu time.
+  std::string scanlines;
+  for (const auto &row : frame.pixels)
+  {
+    scanlines.push_back(0);
+    for (const auto pixel : row)
+    {
+      scanlines.push_back(pixel ? static_cast<char>(0xFF) : 0);
+    }
+  }
+
+  uint32_t a = 1;
+  uint32_t b = 0;
+  for (const unsigned char byte : scanlines)
+  {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+
+  const uint16_t length = scanlines.size();
+
+  std::string data("\x78\x01\x01", 3);
+  data.push_back(static_cast<char>(length & 0xFF));
+  data.push_back(static_cast<char>(length >> 8));
+  data.push_back(static_cast<char>(~length & 0xFF));
+  data.push_back(static_cast<char>((~length >> 8) & 0xFF));
+  data += scanlines;
+  append_be32(data, (b << 16) | a);
+  write_png_chunk(png, "IDAT", data);
+
+  write_png_chunk(png, "IEND", "");
+
+  png.close();
+  if (!png)
+  {
+    if (error.empty())
+    {
+      error = "Could not write " + name.str();
+    }
+    return false;
+  }
+  return true;
+}
+
+} // namespace Chip8
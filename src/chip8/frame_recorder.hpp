@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "framebuffer.hpp"
+
+namespace Chip8
+{
+
+enum class CaptureFormat
+{
+  Y4m,
+  Raw,
+  Png
+};
+
+/**
+ * @brief Records presented frames to disk on a background thread.
+ *
+ * Frames live in a pool that is allocated once up front. The emulation
+ * thread fills a free frame of the pool and hands its index over to the
+ * encoder thread, which writes it out and gives the frame back to the
+ * pool. Both directions use single producer/single consumer rings, so
+ * capturing a frame never blocks. If the encoder falls behind and the pool
+ * runs dry the frame is dropped and counted.
+ */
+class FrameRecorder
+{
+public:
+  /**
+   * Start recording.
+   *
+   * For Y4m and Raw all frames are written into the file at path. For Png
+   * path is used as a prefix and every frame gets its own file named
+   * <path>_<frame number>.png.
+   *
+   * Throws a exception if the output file can not be opened.
+   *
+   * @param path      Output file path
+   * @param format    Output format
+   * @param pool_size Number of preallocated frames
+   */
+  FrameRecorder(const std::string &path,
+                CaptureFormat      format,
+                uint32_t           pool_size = 64);
+
+  ~FrameRecorder();
+
+  FrameRecorder(const FrameRecorder &) = delete;
+  FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+  /**
+   * Queue a frame for encoding. Never blocks.
+   *
+   * @return false if the frame got dropped
+   */
+  bool capture(const Framebuffer &framebuffer);
+
+  /**
+   * Flush all queued frames and stop the encoder thread.
+   */
+  void stop();
+
+  uint64_t get_written_frames() const { return written_frames; }
+
+  uint64_t get_dropped_frames() const { return dropped_frames; }
+
+  /**
+   * Frames that could not be written out.
+   */
+  uint64_t get_failed_frames() const { return failed_frames; }
+
+  /**
+   * Why the first frame that failed could not be written, valid after
+   * stop().
+   */
+  const std::string &get_error() const { return error; }
+
+  /**
+   * Guess the capture format from the file extension of path.
+   */
+  static CaptureFormat format_from_path(const std::string &path);
+
+private:
+  struct Frame
+  {
+    uint64_t    number{};
+    Framebuffer pixels{};
+  };
+
+  /**
+   * Lock free ring of frame indices with one producer and one consumer.
+   */
+  class IndexRing
+  {
+  public:
+    explicit IndexRing(uint32_t capacity);
+
+    bool push(uint32_t index);
+
+    bool pop(uint32_t &index);
+
+  private:
+    std::vector<uint32_t> slots;
+    uint32_t              mask;
+
+    alignas(64) std::atomic<uint32_t> head{0};
+    alignas(64) std::atomic<uint32_t> tail{0};
+  };
+
+  const std::string   path;
+  const CaptureFormat format;
+
+  std::unique_ptr<Frame[]> frames;
+
+  IndexRing free_frames;
+  IndexRing queued_frames;
+
+  std::ofstream out{};
+
+  uint64_t              frame_number = 0;
+  std::atomic<uint64_t> written_frames{0};
+  std::atomic<uint64_t> dropped_frames{0};
+  std::atomic<uint64_t> failed_frames{0};
+  std::string           error{};
+
+  std::atomic<bool>       running{true};
+  std::mutex              wake_mutex{};
+  std::condition_variable wake{};
+  std::thread             encoder_thread{};
+
+  void encode_loop();
+
+  /**
+   * @return false if the frame could not be written, with error set
+   */
+  bool write_frame(const Frame &frame);
+
+  bool write_png(const Frame &frame);
+};
+
+} // namespace Chip8
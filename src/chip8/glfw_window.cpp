@@ -88,17 +88,26 @@ void GlfwWindow::create_window()
 
   glfwSetInputMode(glfw_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 
+  // Windows open on the primary monitor
+  GLFWmonitor       *monitor = glfwGetPrimaryMonitor();
+  const GLFWvidmode *mode    = monitor ? glfwGetVideoMode(monitor) : nullptr;
+  if (mode && mode->refreshRate > 0)
+  {
+    refresh_rate = mode->refreshRate;
+  }
+
   if (!gladLoadGL())
   {
     throw std::runtime_error("Could not initialze glad");
   }
 }
 
-void GlfwWindow::on_key(int /*key*/,
-                        int /*scancode*/,
-                        int /*action*/,
-                        int /*mods*/)
+void GlfwWindow::on_key(int key, int /*scancode*/, int action, int /*mods*/)
 {
+  if (key_event_callback)
+  {
+    key_event_callback(key, action);
+  }
 }
 
 void GlfwWindow::on_window_framebuffer_size(int width, int height)
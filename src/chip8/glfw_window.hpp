@@ -6,6 +6,8 @@
 #include <glad/glad.h>
 // clang-format on
 
+#include <functional>
+
 #include "window.hpp"
 
 #define WINDOW_WIDTH  1024
@@ -17,6 +19,8 @@ namespace Chip8
 class GlfwWindow : public Window
 {
 public:
+  using KeyCallback = std::function<void(int key, int action)>;
+
   void create_window();
 
   bool is_closed() override;
@@ -25,6 +29,17 @@ public:
 
   void terminate() override;
 
+  /**
+   * The rate of the primary monitor once the window is created, 60 Hz
+   * before or if it is unknown.
+   */
+  double get_refresh_rate() const override { return refresh_rate; }
+
+  /**
+   * Set a function that gets called on every key event.
+   */
+  void set_key_callback(KeyCallback callback) { key_event_callback = callback; }
+
   void on_key(int key, int scancode, int action, int mods);
 
   void on_window_framebuffer_size(int width, int height);
@@ -41,7 +56,11 @@ private:
   int32_t window_width  = WINDOW_WIDTH;
   int32_t window_height = WINDOW_HEIGHT;
 
+  double refresh_rate = 60.0;
+
   bool closed = false;
+
+  KeyCallback key_event_callback{};
 };
 
 } // namespace Chip8
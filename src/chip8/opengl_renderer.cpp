@@ -1,5 +1,5 @@
 #include <GL/gl.h>
-#include <cassert>
+#include <chrono>
 #include <stdexcept>
 #include <string>
 
@@ -28,31 +28,19 @@ void OpenGlRenderer::create_window()
   create_pixel_data_tex();
 }
 
-void OpenGlRenderer::clear_display() {}
-
-bool OpenGlRenderer::set_pixel(uint32_t x, uint32_t y)
+void OpenGlRenderer::render(const Framebuffer &framebuffer)
 {
-  assert(x <= 63);
-  assert(y <= 31);
-
-  bool set = false;
-
-  if (pixel_data[x][y] == 0)
-  {
-    set              = true;
-    pixel_data[x][y] = 1;
-  }
-  else
-  {
-    set              = false;
-    pixel_data[x][y] = 0;
-  }
-
-  return set;
-}
+  glBindTexture(GL_TEXTURE_2D, pixel_data_tex_id);
+  glTexSubImage2D(GL_TEXTURE_2D,
+                  0,
+                  0,
+                  0,
+                  display_width,
+                  display_height,
+                  GL_RED,
+                  GL_UNSIGNED_BYTE,
+                  framebuffer.data());
 
-void OpenGlRenderer::render()
-{
   glClear(GL_COLOR_BUFFER_BIT /* | GL_DEPTH_BUFFER_BIT */);
   glViewport(0, 0, glfw_window->get_width(), glfw_window->get_height());
 
@@ -92,14 +80,42 @@ void OpenGlRenderer::load_shaders()
       in vec2 frag_tex_coord;
       layout(location = 0) out vec4 out_color;
 
+      uniform sampler2D pixel_data;
+
       void main()
       {
-        out_color = vec4(frag_tex_coord, 0.0, 1.0);
+        float pixel = texture(pixel_data, frag_tex_coord).r > 0.0 ? 1.0 : 0.0;
+        out_color   = vec4(vec3(pixel), 1.0);
       }
     );
 
   // clang-format on
 
+  const auto start = std::chrono::steady_clock::now();
+
+  const std::string key = ShaderCache::make_key(
+      std::string(vertex_shader_code) + fragment_shader_code);
+
+  shader_id     = glCreateProgram();
+  shader_cached = shader_cache.load(shader_id, key);
+  if (!shader_cached)
+  {
+    // A rejected binary can leave the program unusable, start over
+    glDeleteProgram(shader_id);
+    shader_id = glCreateProgram();
+
+    build_shader_program(vertex_shader_code, fragment_shader_code);
+    shader_cache.store(shader_id, key);
+  }
+
+  shader_time = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+}
+
+void OpenGlRenderer::build_shader_program(const char *vertex_shader_code,
+                                          const char *fragment_shader_code)
+{
   const uint32_t vs_id = glCreateShader(GL_VERTEX_SHADER);
   glShaderSource(vs_id, 1, &vertex_shader_code, nullptr);
   glCompileShader(vs_id);
@@ -110,10 +126,10 @@ void OpenGlRenderer::load_shaders()
   glCompileShader(fs_id);
   check_for_shader_compile_errors(fs_id, "Fragment");
 
-  shader_id = glCreateProgram();
   glAttachShader(shader_id, vs_id);
   glAttachShader(shader_id, fs_id);
 
+  glProgramParameteri(shader_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
   glLinkProgram(shader_id);
   check_for_shader_program_compile_errors(shader_id);
 
@@ -208,12 +224,28 @@ void OpenGlRenderer::terminate()
   glDeleteProgram(shader_id);
   glDeleteVertexArrays(1, &quad_vao_id);
   glDeleteBuffers(1, &quad_vbo_id);
+  glDeleteTextures(1, &pixel_data_tex_id);
 }
 
 void OpenGlRenderer::create_pixel_data_tex()
 {
   glGenTextures(1, &pixel_data_tex_id);
   glBindTexture(GL_TEXTURE_2D, pixel_data_tex_id);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               GL_R8,
+               display_width,
+               display_height,
+               0,
+               GL_RED,
+               GL_UNSIGNED_BYTE,
+               nullptr);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 }
 
 } // namespace Chip8
@@ -1,10 +1,11 @@
 #pragma once
 
-#include <array>
 #include <memory>
 
+#include "framebuffer.hpp"
 #include "glfw_window.hpp"
 #include "renderer.hpp"
+#include "shader_cache.hpp"
 
 namespace Chip8
 {
@@ -16,19 +17,28 @@ public:
 
   void create_window() override;
 
-  void clear_display() override;
+  void render(const Framebuffer &framebuffer) override;
 
-  bool set_pixel(uint32_t x, uint32_t y) override;
+  void terminate() override;
 
-  void render() override;
+  /**
+   * Seconds it took to build the shader program in create_window().
+   */
+  double get_shader_time() const { return shader_time; }
 
-  void terminate() override;
+  /**
+   * Whether the shader program came from the shader cache.
+   */
+  bool is_shader_cached() const { return shader_cached; }
 
 private:
-  std::array<std::array<unsigned char, 32>, 64> pixel_data{};
-
   std::shared_ptr<GlfwWindow> glfw_window{};
 
+  ShaderCache shader_cache{ShaderCache::get_default_directory()};
+
+  double shader_time   = 0.0;
+  bool   shader_cached = false;
+
   uint32_t shader_id{};
   uint32_t quad_vao_id{};
   uint32_t quad_vbo_id{};
@@ -37,6 +47,9 @@ private:
 
   void load_shaders();
 
+  void build_shader_program(const char *vertex_shader_code,
+                            const char *fragment_shader_code);
+
   void check_for_shader_compile_errors(uint32_t id, const char *name);
 
   void check_for_shader_program_compile_errors(uint32_t id);
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <cstdint>
+#include "framebuffer.hpp"
 
 namespace Chip8
 {
@@ -12,11 +12,7 @@ public:
 
   virtual void create_window() = 0;
 
-  virtual void clear_display() = 0;
-
-  virtual bool set_pixel(uint32_t x, uint32_t y) = 0;
-
-  virtual void render() = 0;
+  virtual void render(const Framebuffer &framebuffer) = 0;
 
   virtual void terminate() = 0;
 };
@@ -0,0 +1,492 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "display_delta.hpp"
+#include "server.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+constexpr size_t header_size = 5;
+
+uint32_t read_u32(const uint8_t *data)
+{
+  return data[0] | data[1] << 8 | data[2] << 16 | uint32_t(data[3]) << 24;
+}
+
+void write_u32(uint8_t *data, uint32_t value)
+{
+  data[0] = value;
+  data[1] = value >> 8;
+  data[2] = value >> 16;
+  data[3] = value >> 24;
+}
+
+std::runtime_error system_error(const std::string &what)
+{
+  return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+Server::Server(const std::string &path) : path(path)
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path))
+  {
+    throw std::runtime_error("Socket path is to long: " + path);
+  }
+  std::strcpy(address.sun_path, path.c_str());
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  epoll_fd  = epoll_create1(EPOLL_CLOEXEC);
+  if (listen_fd < 0 || epoll_fd < 0)
+  {
+    const auto error = system_error("Could not create socket");
+    close(listen_fd);
+    close(epoll_fd);
+    throw error;
+  }
+
+  unlink(path.c_str());
+
+  epoll_event event{};
+  event.events  = EPOLLIN;
+  event.data.fd = listen_fd;
+
+  if (bind(listen_fd, reinterpret_cast<sockaddr *>(&address),
+           sizeof(address)) < 0 ||
+      listen(listen_fd, SOMAXCONN) < 0 ||
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) < 0)
+  {
+    const auto error = system_error("Could not listen on " + path);
+    close(listen_fd);
+    close(epoll_fd);
+    throw error;
+  }
+}
+
+Server::~Server()
+{
+  for (const auto &entry : sessions)
+  {
+    close(entry.first);
+  }
+  close(listen_fd);
+  close(epoll_fd);
+  unlink(path.c_str());
+}
+
+void Server::run()
+{
+  std::array<epoll_event, 64> events;
+
+  while (running)
+  {
+    // The timeout bounds how long a stop() between the check and the wait
+    // goes unnoticed. Pending frames only poll.
+    const int count = epoll_wait(epoll_fd, events.data(), events.size(),
+                                 stepping ? 0 : 500);
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      throw system_error("epoll_wait failed");
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+      const int fd = events[i].data.fd;
+      if (fd == listen_fd)
+      {
+        accept_sessions();
+        continue;
+      }
+
+      const auto session = sessions.find(fd);
+      if (session == sessions.end())
+      {
+        continue;
+      }
+
+      // A session with pending frames reads nothing more until they ran
+      bool keep = true;
+      if (!session->second->closing && !session->second->pending_frames &&
+          events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+      {
+        keep = receive(*session->second);
+      }
+
+      // Everything queued while handling the input goes out in one call
+      if (keep)
+      {
+        keep = send(*session->second);
+      }
+
+      if (!keep)
+      {
+        close_session(fd);
+      }
+    }
+
+    run_steps();
+  }
+}
+
+void Server::accept_sessions()
+{
+  for (;;)
+  {
+    const int fd = accept4(listen_fd, nullptr, nullptr,
+                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+      // EAGAIN once all pending connections are accepted. Other errors
+      // only concern the connection that failed.
+      if (errno == EINTR || errno == ECONNABORTED)
+      {
+        continue;
+      }
+      return;
+    }
+
+    epoll_event event{};
+    event.events  = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+      close(fd);
+      continue;
+    }
+
+    auto session    = std::make_unique<Session>();
+    session->fd     = fd;
+    session->events = EPOLLIN;
+    sessions[fd]    = std::move(session);
+  }
+}
+
+bool Server::receive(Session &session)
+{
+  std::array<uint8_t, 16384> buffer;
+
+  while (session.input.size() < max_input_size)
+  {
+    const ssize_t size =
+        read(session.fd, buffer.data(),
+             std::min(buffer.size(), max_input_size - session.input.size()));
+    if (size == 0)
+    {
+      // The client is done sending. Answer what it sent, then close.
+      session.closing = true;
+      break;
+    }
+    if (size < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        break;
+      }
+      return false;
+    }
+    session.input.insert(session.input.end(), buffer.data(),
+                         buffer.data() + size);
+  }
+
+  handle_input(session);
+  return true;
+}
+
+void Server::handle_input(Session &session)
+{
+  size_t offset = 0;
+  while (!session.pending_frames &&
+         session.input.size() - offset >= header_size)
+  {
+    const uint8_t *header = session.input.data() + offset;
+    const uint32_t size   = read_u32(header + 1);
+
+    if (size > max_message_size)
+    {
+      send_error(session, "Message is to long");
+      session.input.clear();
+      return;
+    }
+    if (session.input.size() - offset < header_size + size)
+    {
+      break;
+    }
+
+    if (!handle_message(session, header[0], header + header_size, size))
+    {
+      session.input.clear();
+      return;
+    }
+    offset += header_size + size;
+  }
+
+  session.input.erase(session.input.begin(), session.input.begin() + offset);
+}
+
+void Server::step(Session &session)
+{
+  const uint32_t frames = std::min(session.pending_frames, frames_per_slice);
+  for (uint32_t i = 0; i < frames; ++i)
+  {
+    session.cpu->run(cycles_per_frame);
+  }
+
+  session.pending_frames -= frames;
+  if (!session.pending_frames)
+  {
+    send_frame(session, false);
+  }
+}
+
+void Server::run_steps()
+{
+  stepping = false;
+  std::vector<int> closed;
+  for (const auto &entry : sessions)
+  {
+    Session &session = *entry.second;
+    if (!session.pending_frames)
+    {
+      continue;
+    }
+
+    step(session);
+    if (!session.pending_frames)
+    {
+      handle_input(session);
+      if (!send(session))
+      {
+        closed.push_back(entry.first);
+        continue;
+      }
+    }
+    stepping = stepping || session.pending_frames;
+  }
+
+  for (const int fd : closed)
+  {
+    close_session(fd);
+  }
+}
+
+bool Server::handle_message(Session       &session,
+                            uint8_t        type,
+                            const uint8_t *payload,
+                            uint32_t       size)
+{
+  const auto expect_size = [&](uint32_t expected) {
+    if (size != expected)
+    {
+      send_error(session, "Invalid message size");
+      return false;
+    }
+    return true;
+  };
+
+  switch (type)
+  {
+  case Load:
+  {
+    auto  keyboard     = std::make_unique<HeadlessKeyboard>();
+    auto *new_keyboard = keyboard.get();
+    auto  cpu          = std::make_unique<Cpu>(std::move(keyboard));
+    try
+    {
+      cpu->init();
+      cpu->load_program(payload, size);
+    }
+    catch (const std::exception &e)
+    {
+      send_error(session, e.what());
+      return false;
+    }
+
+    session.keyboard = new_keyboard;
+    session.cpu      = std::move(cpu);
+    send_frame(session, true);
+    return true;
+  }
+
+  case Keys:
+    if (!expect_size(2))
+    {
+      return false;
+    }
+    if (session.keyboard)
+    {
+      session.keyboard->set_keys(payload[0] | payload[1] << 8);
+    }
+    return true;
+
+  case Step:
+  {
+    if (!expect_size(4))
+    {
+      return false;
+    }
+    if (!session.cpu)
+    {
+      send_error(session, "No program loaded");
+      return false;
+    }
+
+    // Frames left after the first slice run from the loop
+    session.pending_frames = read_u32(payload);
+    step(session);
+    return true;
+  }
+
+  case Snapshot:
+    if (!expect_size(0))
+    {
+      return false;
+    }
+    send_frame(session, true);
+    return true;
+
+  default:
+    send_error(session, "Unknown message type");
+    return false;
+  }
+}
+
+void Server::send_frame(Session &session, bool key_frame)
+{
+  static const Framebuffer blank{};
+
+  const Framebuffer &framebuffer =
+      session.cpu ? session.cpu->get_framebuffer() : blank;
+
+  if (key_frame)
+  {
+    session.sent = {};
+  }
+
+  const size_t header = begin_message(session, Frame);
+  session.output.push_back(key_frame ? key_frame_flag : 0);
+  encode_display_delta(session.sent, framebuffer, session.output);
+  end_message(session, header);
+}
+
+void Server::send_error(Session &session, const std::string &text)
+{
+  const size_t header = begin_message(session, Error);
+  session.output.insert(session.output.end(), text.begin(), text.end());
+  end_message(session, header);
+
+  session.closing = true;
+}
+
+size_t Server::begin_message(Session &session, uint8_t type)
+{
+  const size_t offset = session.output.size();
+  session.output.push_back(type);
+  session.output.resize(offset + header_size);
+  return offset;
+}
+
+void Server::end_message(Session &session, size_t header_offset)
+{
+  write_u32(session.output.data() + header_offset + 1,
+            session.output.size() - header_offset - header_size);
+}
+
+bool Server::send(Session &session)
+{
+  auto &out = session.output;
+
+  while (session.output_offset < out.size())
+  {
+    const ssize_t size = ::send(session.fd, out.data() + session.output_offset,
+                                out.size() - session.output_offset,
+                                MSG_NOSIGNAL);
+    if (size < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        break;
+      }
+      return false;
+    }
+    session.output_offset += size;
+  }
+
+  if (session.output_offset == out.size())
+  {
+    out.clear();
+    session.output_offset = 0;
+
+    if (session.closing && !session.pending_frames)
+    {
+      return false;
+    }
+  }
+
+  return update_events(session);
+}
+
+bool Server::update_events(Session &session)
+{
+  // A session with pending frames reads nothing more until they ran
+  const bool reading = !session.closing && !session.pending_frames;
+  const bool writing = session.output_offset < session.output.size();
+
+  uint32_t events = 0;
+  if (reading)
+  {
+    events |= EPOLLIN;
+  }
+  if (writing)
+  {
+    events |= EPOLLOUT;
+  }
+  if (events == session.events)
+  {
+    return true;
+  }
+
+  epoll_event event{};
+  event.events  = events;
+  event.data.fd = session.fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, session.fd, &event) < 0)
+  {
+    return false;
+  }
+  session.events = events;
+  return true;
+}
+
+void Server::close_session(int fd)
+{
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  sessions.erase(fd);
+}
+
+} // namespace Chip8
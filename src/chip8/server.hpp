@@ -0,0 +1,214 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu.hpp"
+#include "headless_keyboard.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief Headless server that runs one cpu per session on a Unix domain
+ * socket.
+ *
+ * All sessions are served by a single thread with an epoll loop. Every
+ * message has a 5 byte header, the type and the length of the payload as
+ * 32 bit little endian, followed by the payload.
+ *
+ * Messages from the client:
+ *
+ *   Load      program          Reset the machine and load a program
+ *   Keys      u16 mask         Set the pressed keys, bit n is key n
+ *   Step      u32 frames       Run frames and send a Frame
+ *   Snapshot  -                Send a key Frame with the whole display
+ *
+ * Messages from the server:
+ *
+ *   Frame     u8 flags, rows   Display update
+ *   Error     text             The session gets closed afterwards
+ *
+ * A frame contains only the rows that changed since the last frame sent,
+ * as runs of changed and unchanged pixels, see encode_display_delta(). With
+ * the key frame flag set the rows are relative to a blank display.
+ *
+ * Long steps run in slices, serving the other sessions in between. Messages
+ * after a Step get handled once it is answered.
+ */
+class Server
+{
+public:
+  enum MessageType : uint8_t
+  {
+    Load     = 0x01,
+    Keys     = 0x02,
+    Step     = 0x03,
+    Snapshot = 0x04,
+    Frame    = 0x81,
+    Error    = 0x82
+  };
+
+  static constexpr uint8_t key_frame_flag = 0x01;
+
+  /**
+   * Listen on a Unix domain socket. An existing file at path is replaced.
+   *
+   * Throws a exception if the socket can not be created.
+   */
+  explicit Server(const std::string &path);
+
+  ~Server();
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+
+  /**
+   * Serve sessions until stop() is called.
+   */
+  void run();
+
+  /**
+   * Make run() return. Safe to call from a signal handler.
+   */
+  void stop() { running = false; }
+
+private:
+  struct Session
+  {
+    int fd;
+
+    std::unique_ptr<Cpu> cpu{};
+    HeadlessKeyboard    *keyboard{};
+
+    /**
+     * Display as the client knows it.
+     */
+    Framebuffer sent{};
+
+    std::vector<uint8_t> input{};
+    std::vector<uint8_t> output{};
+    size_t               output_offset = 0;
+
+    /**
+     * Frames of the current Step still to run.
+     */
+    uint32_t pending_frames = 0;
+
+    /**
+     * Events the socket is registered for in the epoll set.
+     */
+    uint32_t events = 0;
+
+    bool closing = false;
+  };
+
+  /**
+   * Same as the simulator, which runs one cycle per presented frame.
+   */
+  const uint32_t cycles_per_frame = 1;
+
+  /**
+   * Frames a Step runs before the other sessions get served again, well
+   * below a millisecond.
+   */
+  const uint32_t frames_per_slice = 1 << 16;
+
+  /**
+   * Bigger messages close the session. The largest valid message is a
+   * program filling all memory after the interpreter area.
+   */
+  const uint32_t max_message_size = 4096;
+
+  /**
+   * Input buffered per session at most. The rest stays in the socket until
+   * the messages before it got handled.
+   */
+  const size_t max_input_size = 1 << 16;
+
+  const std::string path;
+
+  int listen_fd = -1;
+  int epoll_fd  = -1;
+
+  std::atomic<bool> running{true};
+
+  std::unordered_map<int, std::unique_ptr<Session>> sessions{};
+
+  /**
+   * Some session has frames pending, so the loop must not block.
+   */
+  bool stepping = false;
+
+  void accept_sessions();
+
+  /**
+   * Read what is available, up to max_input_size, and handle all complete
+   * messages.
+   *
+   * @return false if the session has to be closed
+   */
+  bool receive(Session &session);
+
+  /**
+   * Handle the complete messages in the input, up to a Step that is not
+   * done in its first slice.
+   */
+  void handle_input(Session &session);
+
+  /**
+   * Run a slice of the pending frames and send a Frame once all ran.
+   */
+  void step(Session &session);
+
+  /**
+   * Run a slice of every session with pending frames, and the messages
+   * that waited for them.
+   */
+  void run_steps();
+
+  bool handle_message(Session       &session,
+                      uint8_t        type,
+                      const uint8_t *payload,
+                      uint32_t       size);
+
+  void send_frame(Session &session, bool key_frame);
+
+  void send_error(Session &session, const std::string &text);
+
+  /**
+   * Append a message header to the output.
+   *
+   * @return Offset of the header, to be passed to end_message()
+   */
+  size_t begin_message(Session &session, uint8_t type);
+
+  /**
+   * Fill in the payload length of the message started at header_offset.
+   */
+  void end_message(Session &session, size_t header_offset);
+
+  /**
+   * Write as much of the queued output as the socket takes.
+   *
+   * @return false if the session has to be closed
+   */
+  bool send(Session &session);
+
+  /**
+   * Register the socket for input only while the session takes any, and
+   * for output only while some is pending. Level triggered input would
+   * otherwise wake the loop all the time, e.g. after the end of the input.
+   *
+   * @return false if the session has to be closed
+   */
+  bool update_events(Session &session);
+
+  void close_session(int fd);
+};
+
+} // namespace Chip8
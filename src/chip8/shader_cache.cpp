@@ -0,0 +1,159 @@
+// clang-format off
+#include <glad/glad.h>
+// clang-format on
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <vector>
+
+#include "shader_cache.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+struct Header
+{
+  char     magic[8]    = {'C', 'H', 'I', 'P', '8', 'S', 'H', 'D'};
+  uint32_t key_size    = 0;
+  uint32_t format      = 0;
+  uint32_t binary_size = 0;
+};
+
+uint64_t hash_key(const std::string &key)
+{
+  // FNV-1a, only used to name the file. The key itself is compared.
+  uint64_t hash = 0xcbf29ce484222325;
+  for (const char c : key)
+  {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+  }
+  return hash;
+}
+
+std::string get_string(GLenum name)
+{
+  const auto *text = reinterpret_cast<const char *>(glGetString(name));
+  return text ? text : "";
+}
+
+} // namespace
+
+ShaderCache::ShaderCache(const std::string &directory) : directory(directory)
+{
+}
+
+std::string ShaderCache::get_default_directory()
+{
+  if (const char *cache_home = std::getenv("XDG_CACHE_HOME"))
+  {
+    return std::string(cache_home) + "/chip8";
+  }
+  if (const char *home = std::getenv("HOME"))
+  {
+    return std::string(home) + "/.cache/chip8";
+  }
+  return "";
+}
+
+std::string ShaderCache::make_key(const std::string &sources)
+{
+  return get_string(GL_VENDOR) + '\n' + get_string(GL_RENDERER) + '\n' +
+         get_string(GL_VERSION) + '\n' + sources;
+}
+
+bool ShaderCache::load(uint32_t program, const std::string &key) const
+{
+  if (directory.empty())
+  {
+    return false;
+  }
+
+  std::ifstream in(get_path(key), std::ios::in | std::ios::binary);
+
+  Header header;
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, Header().magic, sizeof(header.magic)) != 0 ||
+      header.key_size != key.size())
+  {
+    return false;
+  }
+
+  std::string       stored_key(header.key_size, '\0');
+  std::vector<char> binary(header.binary_size);
+  if (!in.read(&stored_key[0], stored_key.size()) || stored_key != key ||
+      !in.read(binary.data(), binary.size()))
+  {
+    return false;
+  }
+
+  glProgramBinary(program, header.format, binary.data(), binary.size());
+
+  GLint success = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  return success == GL_TRUE;
+}
+
+void ShaderCache::store(uint32_t program, const std::string &key) const
+{
+  if (directory.empty())
+  {
+    return;
+  }
+
+  GLint size = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+  if (size <= 0)
+  {
+    return;
+  }
+
+  Header            header;
+  std::vector<char> binary(size);
+  GLenum            format = 0;
+  glGetProgramBinary(program, size, nullptr, &format, binary.data());
+
+  header.key_size    = key.size();
+  header.format      = format;
+  header.binary_size = binary.size();
+
+  // The parent has to exist, the cache directory is created if missing
+  const size_t slash = directory.rfind('/');
+  if (slash != std::string::npos && slash > 0)
+  {
+    mkdir(directory.substr(0, slash).c_str(), 0755);
+  }
+  mkdir(directory.c_str(), 0755);
+
+  // Written aside and renamed, so that a parallel launch never reads half
+  // a binary
+  const std::string path           = get_path(key);
+  const std::string temporary_path = path + ".tmp";
+  {
+    std::ofstream out(temporary_path,
+                      std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(key.data(), key.size());
+    out.write(binary.data(), binary.size());
+    if (!out)
+    {
+      return;
+    }
+  }
+  std::rename(temporary_path.c_str(), path.c_str());
+}
+
+std::string ShaderCache::get_path(const std::string &key) const
+{
+  char name[40];
+  std::snprintf(name, sizeof(name), "/program-%016llx.bin",
+                static_cast<unsigned long long>(hash_key(key)));
+  return directory + name;
+}
+
+} // namespace Chip8
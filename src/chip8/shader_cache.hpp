@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Chip8
+{
+
+/**
+ * @brief Keeps linked shader programs on disk, so that later launches skip
+ * compiling and linking them.
+ *
+ * Binaries are only valid for the driver that produced them. The key of a
+ * program is made of the driver strings and the shader sources, and a
+ * binary is only used if its key matches exactly. A driver that rejects a
+ * binary anyway, e.g. after an update with the same version string, makes
+ * load() fail and the program gets built from source again.
+ */
+class ShaderCache
+{
+public:
+  /**
+   * @param directory Where to keep the binaries. Empty disables the cache.
+   */
+  explicit ShaderCache(const std::string &directory);
+
+  /**
+   * $XDG_CACHE_HOME/chip8 or ~/.cache/chip8, empty if neither is set.
+   */
+  static std::string get_default_directory();
+
+  /**
+   * Key of a program built from the given sources by the current driver.
+   * Needs a current context.
+   */
+  static std::string make_key(const std::string &sources);
+
+  /**
+   * Load a binary stored before into the program.
+   *
+   * @return true if the program is linked now
+   */
+  bool load(uint32_t program, const std::string &key) const;
+
+  /**
+   * Store the binary of a linked program. The program has to be linked
+   * with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set. Failures are ignored, the
+   * cache is only an optimization.
+   */
+  void store(uint32_t program, const std::string &key) const;
+
+private:
+  std::string directory;
+
+  std::string get_path(const std::string &key) const;
+};
+
+} // namespace Chip8
@@ -1,8 +1,14 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
 #include <fstream>
+#include <iostream>
 #include <ios>
 #include <iterator>
 #include <memory>
 #include <sys/time.h>
+#include <thread>
 
 #include "cpu.hpp"
 #include "glfw_window.hpp"
@@ -13,25 +19,51 @@
 namespace Chip8
 {
 
-int64_t get_current_time_millis()
+double get_current_time()
 {
   timeval t;
   gettimeofday(&t, nullptr);
 
-  auto ret = t.tv_sec * 1000 + t.tv_usec / 1000;
-
-  return ret;
+  return double(t.tv_sec) + double(t.tv_usec) / 1000000.0;
 }
 
 Simulator::Simulator()
 {
+  launch_time = get_current_time();
+
   auto glfw_window = std::make_shared<GlfwWindow>();
   window           = glfw_window;
 
-  renderer      = std::make_shared<OpenGlRenderer>(glfw_window);
+  glfw_window->set_key_callback([this](int key, int action) {
+    if (key == GLFW_KEY_TAB && action == GLFW_PRESS)
+    {
+      turbo = !turbo;
+    }
+
+    if (debugger && action == GLFW_PRESS)
+    {
+      if (key == GLFW_KEY_F5)
+      {
+        debugger->is_stopped() ? debugger->resume() : debugger->pause();
+      }
+      else if (key == GLFW_KEY_F10)
+      {
+        debugger->step();
+      }
+      else if (key == GLFW_KEY_F11)
+      {
+        debugger->step_frame();
+      }
+    }
+  });
+
+  auto new_renderer = std::make_shared<OpenGlRenderer>(glfw_window);
+  opengl_renderer   = new_renderer.get();
+  renderer          = new_renderer;
+
   auto keyboard = std::make_unique<ModernKeyboard>();
 
-  cpu = std::make_unique<Cpu>(renderer, std::move(keyboard));
+  cpu = std::make_unique<Cpu>(std::move(keyboard));
   cpu->init();
 }
 
@@ -39,32 +71,260 @@ void Simulator::load_program(const std::string &filepath)
 {
   const auto program = load_program_from_disk(filepath);
   cpu->load_program(program);
+
+  program_filepath = filepath;
+  program_size     = program.size();
+}
+
+void Simulator::load_aot_module(const std::string &filepath)
+{
+  const AotModule &module = Chip8::load_aot_module(filepath);
+
+  auto engine   = std::make_unique<AotEngine>(module, *cpu);
+  aot_engine    = engine.get();
+  fusion_engine = nullptr;
+  debugger      = nullptr;
+  debug_console.reset();
+  cpu->set_engine(std::move(engine));
+}
+
+void Simulator::enable_fusion()
+{
+  auto engine   = std::make_unique<FusionEngine>();
+  fusion_engine = engine.get();
+  aot_engine    = nullptr;
+  debugger      = nullptr;
+  debug_console.reset();
+  cpu->set_engine(std::move(engine));
+}
+
+void Simulator::attach_debugger()
+{
+  auto engine   = std::make_unique<Debugger>();
+  debugger      = engine.get();
+  aot_engine    = nullptr;
+  fusion_engine = nullptr;
+  cpu->set_engine(std::move(engine));
+
+  debug_console = std::make_unique<DebugConsole>(*debugger, *cpu);
+}
+
+void Simulator::start_trace(const std::string &filepath)
+{
+  cpu->set_tracer(std::make_unique<Tracer>(filepath));
+}
+
+void Simulator::watch_program()
+{
+  program_watcher = std::make_unique<FileWatcher>(program_filepath);
+}
+
+void Simulator::start_capture(const std::string &filepath,
+                              CaptureFormat      format)
+{
+  frame_recorder = std::make_unique<FrameRecorder>(filepath, format);
+}
+
+void Simulator::open_window()
+{
+  std::atomic<bool>  window_ready{false};
+  std::exception_ptr emulation_error{};
+
+  std::thread emulation_thread([&] {
+    try
+    {
+      const double start = get_current_time();
+      while (!window_ready)
+      {
+        const double speed = turbo ? turbo_speed : 1.0;
+        if (speed <= 0.0)
+        {
+          cpu->run(uncapped_batch_size);
+          startup_cycles += uncapped_batch_size;
+          continue;
+        }
+
+        const auto due = uint64_t((get_current_time() - start) * fps * speed);
+        if (due > startup_cycles)
+        {
+          cpu->run(due - startup_cycles);
+          startup_cycles = due;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    catch (...)
+    {
+      emulation_error = std::current_exception();
+    }
+  });
+
+  const double start_time = get_current_time();
+  try
+  {
+    renderer->create_window();
+  }
+  catch (...)
+  {
+    window_ready = true;
+    emulation_thread.join();
+    throw;
+  }
+  window_time  = get_current_time() - start_time;
+  refresh_rate = window->get_refresh_rate();
+
+  window_ready = true;
+  emulation_thread.join();
+
+  if (emulation_error)
+  {
+    std::rethrow_exception(emulation_error);
+  }
 }
 
 void Simulator::execute()
 {
-  double accumulator = 0.0;
-  double old_time    = double(get_current_time_millis()) / 1000.0;
+  open_window();
+
+  double accumulator  = 0.0;
+  double old_time     = get_current_time();
+  double next_present = old_time;
 
   while (!window->is_closed())
   {
-    const double current_time = double(get_current_time_millis()) / 1000.0;
+    double       current_time = get_current_time();
     const double delta_time   = current_time - old_time;
     old_time                  = current_time;
 
-    accumulator += delta_time;
+    if (debug_console)
+    {
+      debug_console->update();
+    }
+
+    if (turbo && turbo_speed <= 0.0)
+    {
+      // Uncapped. Emulate in batches until the next frame is due.
+      while (current_time < next_present)
+      {
+        cpu->run(uncapped_batch_size);
+        current_time = get_current_time();
+      }
+
+      old_time    = current_time;
+      accumulator = 0.0;
+    }
+    else
+    {
+      accumulator += delta_time * (turbo ? turbo_speed : 1.0);
+
+      uint32_t cycles = 0;
+      while (accumulator > 1.0 / fps)
+      {
+        ++cycles;
+        accumulator -= 1.0 / fps;
+      }
+      cpu->run(cycles);
+    }
+
+    // In turbo mode only present at the refresh rate, so that drawing and
+    // swapping does not limit the emulation speed
+    if (turbo && current_time < next_present)
+    {
+      continue;
+    }
+    next_present = current_time + 1.0 / refresh_rate;
 
-    while (accumulator > 1.0 / fps)
+    if (program_watcher && program_watcher->poll())
     {
-      cpu->cycle();
-      accumulator -= 1.0 / fps;
+      reload_program();
     }
 
-    renderer->render();
-    window->flush();
+    present();
   }
 }
 
+void Simulator::reload_program()
+{
+  const double start_time = get_current_time();
+
+  try
+  {
+    const auto program = load_program_from_disk(program_filepath);
+
+    // An empty file is most likely a writer that has only just truncated
+    if (program.empty())
+    {
+      return;
+    }
+
+    cpu->replace_program(program, program_size);
+    program_size = program.size();
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << "Reload of " << program_filepath << " failed: " << e.what()
+              << std::endl;
+    return;
+  }
+
+  std::cerr << "Reloaded " << program_filepath << " in "
+            << (get_current_time() - start_time) * 1000.0 << " ms"
+            << std::endl;
+}
+
+void Simulator::present()
+{
+  // Speculative frames would end up in the trace or hit breakpoints
+  const Framebuffer &framebuffer =
+      run_ahead_frames > 0 && !cpu->get_tracer() && !debugger
+          ? run_ahead()
+          : cpu->get_framebuffer();
+
+  renderer->render(framebuffer);
+  window->flush();
+
+  if (frame_recorder)
+  {
+    frame_recorder->capture(framebuffer);
+  }
+
+  if (first_frame)
+  {
+    first_frame = false;
+    std::cerr << "First frame after "
+              << (get_current_time() - launch_time) * 1000.0 << " ms: window "
+              << window_time * 1000.0 << " ms, of that shaders "
+              << opengl_renderer->get_shader_time() * 1000.0 << " ms "
+              << (opengl_renderer->is_shader_cached() ? "from the cache"
+                                                      : "compiled")
+              << ", " << startup_cycles << " cycles run meanwhile"
+              << std::endl;
+  }
+}
+
+const Framebuffer &Simulator::run_ahead()
+{
+  const double start_time = get_current_time();
+
+  // Run the following frames speculatively with the current input and roll
+  // back afterwards. Only the resulting image is kept.
+  run_ahead_state = cpu->get_state();
+
+  const uint32_t cycles_per_frame = std::max(1u, uint32_t(fps / refresh_rate));
+  cpu->run(run_ahead_frames * cycles_per_frame);
+
+  run_ahead_framebuffer = cpu->get_framebuffer();
+  cpu->set_state(run_ahead_state);
+
+  const double time = get_current_time() - start_time;
+
+  run_ahead_time += time;
+  ++run_ahead_count;
+  run_ahead_max_time = std::max(run_ahead_max_time, time);
+
+  return run_ahead_framebuffer;
+}
+
 std::vector<byte_t>
 Simulator::load_program_from_disk(const std::string &filepath)
 {
@@ -78,6 +338,63 @@ Simulator::load_program_from_disk(const std::string &filepath)
 
 void Simulator::terminate()
 {
+  if (aot_engine)
+  {
+    std::cerr << "Aot: " << aot_engine->get_native_cycles()
+              << " cycles native, " << aot_engine->get_interpreted_cycles()
+              << " cycles interpreted" << std::endl;
+  }
+
+  if (fusion_engine)
+  {
+    const auto &statistics = fusion_engine->get_statistics();
+    const auto  fused      = statistics.get_fused_cycles();
+
+    std::cerr << "Fusion: " << fused << " of " << statistics.cycles
+              << " cycles fused ("
+              << (statistics.cycles ? 100.0 * fused / statistics.cycles : 0.0)
+              << "%)" << std::endl;
+
+    for (size_t i = 0; i < statistics.fused_cycles.size(); ++i)
+    {
+      if (statistics.fused_cycles[i] > 0)
+      {
+        std::cerr << "  " << FusionEngine::get_kind_name(FusionEngine::Kind(i))
+                  << ": " << statistics.fused_cycles[i] << std::endl;
+      }
+    }
+  }
+
+  if (run_ahead_count > 0)
+  {
+    std::cerr << "Run-ahead: " << run_ahead_frames << " frames, "
+              << run_ahead_time / run_ahead_count * 1000000.0
+              << " us average overhead per frame, "
+              << run_ahead_max_time * 1000000.0 << " us max" << std::endl;
+  }
+
+  if (Tracer *tracer = cpu->get_tracer())
+  {
+    tracer->stop();
+    std::cerr << "Trace: " << tracer->get_written_records()
+              << " instructions written to " << tracer->get_path()
+              << std::endl;
+  }
+
+  if (frame_recorder)
+  {
+    frame_recorder->stop();
+    std::cerr << "Capture: " << frame_recorder->get_written_frames()
+              << " frames written, " << frame_recorder->get_dropped_frames()
+              << " frames dropped" << std::endl;
+    if (frame_recorder->get_failed_frames() > 0)
+    {
+      std::cerr << "Capture: " << frame_recorder->get_failed_frames()
+                << " frames failed, " << frame_recorder->get_error()
+                << std::endl;
+    }
+  }
+
   renderer->terminate();
   window->terminate();
 }
@@ -4,8 +4,15 @@
 #include <string>
 #include <vector>
 
+#include "aot_engine.hpp"
 #include "cpu.hpp"
+#include "debug_console.hpp"
+#include "debugger.hpp"
+#include "file_watcher.hpp"
+#include "frame_recorder.hpp"
+#include "fusion_engine.hpp"
 #include "glfw_window.hpp"
+#include "opengl_renderer.hpp"
 #include "renderer.hpp"
 #include "window.hpp"
 
@@ -26,7 +33,80 @@ public:
   void load_program(const std::string &filepath);
 
   /**
-   * Execute the currently loaded program.
+   * Run the loaded program with code recompiled by chip8_aot.
+   *
+   * Throws a exception if the library can not be loaded or was built from
+   * a different program.
+   *
+   * @param filepath Shared library built from the output of chip8_aot
+   */
+  void load_aot_module(const std::string &filepath);
+
+  /**
+   * Execute common instruction sequences as one. The share of fused
+   * cycles is reported on exit.
+   */
+  void enable_fusion();
+
+  /**
+   * Run under a debugger controlled from stdin, see DebugConsole. The
+   * machine starts paused. This replaces any other engine, and run-ahead
+   * is not used, so that no speculative cycle hits a breakpoint. Without a
+   * debugger nothing checks for breakpoints at all.
+   */
+  void attach_debugger();
+
+  /**
+   * Record every presented frame to disk.
+   *
+   * @param filepath File to write the frames to
+   * @param format   Output format
+   */
+  void start_capture(const std::string &filepath, CaptureFormat format);
+
+  /**
+   * Record every executed instruction into a binary trace file, which
+   * chip8_trace prints. Engines and run-ahead are not used while tracing,
+   * so that the trace holds exactly the instructions that ran.
+   *
+   * Throws a exception if the trace file can not be opened.
+   */
+  void start_trace(const std::string &filepath);
+
+  /**
+   * Reload the program whenever its file changes on disk. Only the program
+   * gets swapped, the machine keeps running with its registers and the
+   * rest of memory. A file that can not be read is skipped until the next
+   * change.
+   *
+   * Throws a exception if the file can not be watched.
+   */
+  void watch_program();
+
+  /**
+   * Set the speed used while turbo mode is active.
+   *
+   * @param speed Multiple of the normal speed. 0 runs as fast as possible.
+   */
+  void set_turbo_speed(double speed) { turbo_speed = speed; }
+
+  /**
+   * Enable or disable turbo mode. Can also be toggled with the tab key.
+   */
+  void set_turbo(bool enabled) { turbo = enabled; }
+
+  /**
+   * Present each frame as it will look a number of frames in the future,
+   * using the current input. This hides the input lag built into many
+   * programs.
+   *
+   * @param frames Number of frames to run ahead. 0 disables run-ahead.
+   */
+  void set_run_ahead(uint32_t frames) { run_ahead_frames = frames; }
+
+  /**
+   * Execute the currently loaded program. The window gets opened here,
+   * while the program already runs, see open_window().
    */
   void execute();
 
@@ -38,10 +118,78 @@ public:
 private:
   uint32_t fps = 60;
 
+  /**
+   * Rate at which frames get presented in turbo mode, the one of the
+   * monitor once the window is open.
+   */
+  double refresh_rate = 60.0;
+
+  /**
+   * Number of cycles run between two clock reads if the speed is uncapped.
+   */
+  uint32_t uncapped_batch_size = 1000;
+
+  double turbo_speed = 0.0;
+  bool   turbo       = false;
+
+  uint32_t    run_ahead_frames = 0;
+  CpuState    run_ahead_state{};
+  Framebuffer run_ahead_framebuffer{};
+
+  /**
+   * Statistics about the time spent running ahead.
+   */
+  uint64_t run_ahead_count    = 0;
+  double   run_ahead_time     = 0.0;
+  double   run_ahead_max_time = 0.0;
+
   std::shared_ptr<Renderer> renderer{};
   std::shared_ptr<Window>   window{};
   std::unique_ptr<Cpu>      cpu{};
 
+  /**
+   * Owned by renderer, for the startup report.
+   */
+  OpenGlRenderer *opengl_renderer{};
+
+  /**
+   * When the simulator got created, the start of the time to the first
+   * frame.
+   */
+  double   launch_time    = 0.0;
+  double   window_time    = 0.0;
+  uint64_t startup_cycles = 0;
+  bool     first_frame    = true;
+
+  std::unique_ptr<FrameRecorder> frame_recorder{};
+
+  std::string                  program_filepath{};
+  size_t                       program_size = 0;
+  std::unique_ptr<FileWatcher> program_watcher{};
+
+  /**
+   * Owned by the cpu. The library it runs stays loaded until exit.
+   */
+  AotEngine    *aot_engine{};
+  FusionEngine *fusion_engine{};
+  Debugger     *debugger{};
+
+  std::unique_ptr<DebugConsole> debug_console{};
+
+  /**
+   * Create the window, the context and the shaders. The program runs on a
+   * thread of its own meanwhile, so that it starts at once. Glfw needs
+   * windows to be made on the main thread, so the emulation is the part
+   * that moves.
+   */
+  void open_window();
+
+  void present();
+
+  void reload_program();
+
+  const Framebuffer &run_ahead();
+
   std::vector<byte_t> load_program_from_disk(const std::string &filepath);
 };
 
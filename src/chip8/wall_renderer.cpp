@@ -0,0 +1,314 @@
+#include <GL/gl.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "wall_renderer.hpp"
+
+#define GLSL_SHADER_CODE(code) "#version 460 core\n" #code
+
+namespace Chip8
+{
+
+namespace
+{
+
+constexpr size_t framebuffer_size = display_width * display_height;
+
+uint32_t compile_shader(GLenum type, const char *code, const char *name)
+{
+  const uint32_t id = glCreateShader(type);
+  glShaderSource(id, 1, &code, nullptr);
+  glCompileShader(id);
+
+  GLint success;
+  glGetShaderiv(id, GL_COMPILE_STATUS, &success);
+  if (!success)
+  {
+    GLchar info_log[1024];
+    glGetShaderInfoLog(id, sizeof(info_log), nullptr, info_log);
+    throw std::runtime_error(std::string(name) + " Shader Error:\n" +
+                             info_log);
+  }
+  return id;
+}
+
+} // namespace
+
+WallRenderer::WallRenderer(std::shared_ptr<GlfwWindow> glfw_window,
+                           uint32_t                    count)
+    : glfw_window(glfw_window), count(count)
+{
+}
+
+void WallRenderer::create_window()
+{
+  glfw_window->create_window();
+
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+  load_shaders();
+  create_pixel_data_tex();
+
+  // Vertices are made up in the vertex shader, but core profile wants a
+  // vertex array bound to draw
+  glGenVertexArrays(1, &vao_id);
+  glGenBuffers(1, &pixel_buffer_id);
+}
+
+void WallRenderer::render(const byte_t   *framebuffers,
+                          size_t          stride,
+                          const uint32_t *dirty_rows)
+{
+  upload_changes(framebuffers, stride, dirty_rows);
+  update_layout();
+
+  const float width  = static_cast<float>(layout_width);
+  const float height = static_cast<float>(layout_height);
+
+  glClear(GL_COLOR_BUFFER_BIT);
+  glViewport(0, 0, glfw_window->get_width(), glfw_window->get_height());
+
+  glUseProgram(shader_id);
+  glUniform1i(glGetUniformLocation(shader_id, "columns"), columns);
+  glUniform2f(glGetUniformLocation(shader_id, "cell_size"),
+              2.0f * cell_size * display_width / width,
+              2.0f * cell_size * display_height / height);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, pixel_data_tex_id);
+  glBindVertexArray(vao_id);
+
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+
+  ++statistics.frames;
+}
+
+void WallRenderer::update_layout()
+{
+  if (glfw_window->get_width() == layout_width &&
+      glfw_window->get_height() == layout_height)
+  {
+    return;
+  }
+  layout_width  = glfw_window->get_width();
+  layout_height = glfw_window->get_height();
+
+  const float width  = static_cast<float>(layout_width);
+  const float height = static_cast<float>(layout_height);
+
+  columns   = 1;
+  cell_size = 0.0f;
+  for (uint32_t candidate = 1; candidate <= count; ++candidate)
+  {
+    const uint32_t rows = (count + candidate - 1) / candidate;
+    const float    size = std::min(width / (candidate * display_width),
+                                height / (rows * display_height));
+    if (size > cell_size)
+    {
+      cell_size = size;
+      columns   = candidate;
+    }
+  }
+}
+
+void WallRenderer::upload_changes(const byte_t   *framebuffers,
+                                  size_t          stride,
+                                  const uint32_t *dirty_rows)
+{
+  staging.clear();
+  uploads.clear();
+
+  for (uint32_t layer = 0; layer < count; ++layer)
+  {
+    const uint32_t rows = dirty_rows[layer];
+    if (!rows)
+    {
+      continue;
+    }
+    const byte_t *framebuffer = framebuffers + layer * stride;
+
+    // Neighbouring changed rows go up together
+    for (uint32_t row = 0; row < display_height; ++row)
+    {
+      if (!(rows >> row & 1))
+      {
+        continue;
+      }
+      const size_t offset = row * display_width;
+
+      if (!uploads.empty() && uploads.back().layer == layer &&
+          uploads.back().row + uploads.back().rows == row)
+      {
+        ++uploads.back().rows;
+      }
+      else
+      {
+        uploads.push_back({layer, row, 1, staging.size()});
+      }
+      staging.insert(staging.end(), framebuffer + offset,
+                     framebuffer + offset + display_width);
+    }
+  }
+
+  if (uploads.empty())
+  {
+    return;
+  }
+
+  // One transfer for the frame, the copies into the layers read from it
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer_id);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, staging.size(), staging.data(),
+               GL_STREAM_DRAW);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, pixel_data_tex_id);
+  for (const Upload &upload : uploads)
+  {
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                    0,
+                    0,
+                    upload.row,
+                    upload.layer,
+                    display_width,
+                    upload.rows,
+                    1,
+                    GL_RED,
+                    GL_UNSIGNED_BYTE,
+                    reinterpret_cast<void *>(upload.offset));
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  statistics.changed_rows += staging.size() / display_width;
+  statistics.uploads += uploads.size();
+}
+
+void WallRenderer::load_shaders()
+{
+  // clang-format off
+  const char *vertex_shader_code = GLSL_SHADER_CODE(
+    uniform int  columns;
+    uniform vec2 cell_size;
+
+    out vec2 frag_tex_coord;
+    flat out int layer;
+
+    void main()
+    {
+      // Triangle strip over the corners of the cell of this instance
+      vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+      int column = gl_InstanceID % columns;
+      int row    = gl_InstanceID / columns;
+
+      vec2 margin      = cell_size * 0.02;
+      vec2 bottom_left = vec2(-1.0, 1.0) + vec2(column, -row - 1) * cell_size;
+
+      frag_tex_coord = vec2(corner.x, 1.0 - corner.y);
+      layer          = gl_InstanceID;
+      gl_Position    = vec4(bottom_left + margin +
+                            corner * (cell_size - 2.0 * margin), 0.0, 1.0);
+    }
+    );
+
+  const char *fragment_shader_code = GLSL_SHADER_CODE(
+      in vec2 frag_tex_coord;
+      flat in int layer;
+      layout(location = 0) out vec4 out_color;
+
+      uniform sampler2DArray pixel_data;
+
+      void main()
+      {
+        float pixel =
+            texture(pixel_data, vec3(frag_tex_coord, layer)).r > 0.0 ? 1.0
+                                                                     : 0.1;
+        out_color = vec4(vec3(pixel), 1.0);
+      }
+    );
+
+  // clang-format on
+
+  const std::string key = ShaderCache::make_key(
+      std::string(vertex_shader_code) + fragment_shader_code);
+
+  shader_id = glCreateProgram();
+  if (shader_cache.load(shader_id, key))
+  {
+    return;
+  }
+
+  glDeleteProgram(shader_id);
+  shader_id = glCreateProgram();
+
+  const uint32_t vs_id =
+      compile_shader(GL_VERTEX_SHADER, vertex_shader_code, "Vertex");
+  const uint32_t fs_id =
+      compile_shader(GL_FRAGMENT_SHADER, fragment_shader_code, "Fragment");
+
+  glAttachShader(shader_id, vs_id);
+  glAttachShader(shader_id, fs_id);
+
+  glProgramParameteri(shader_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glLinkProgram(shader_id);
+
+  glDeleteShader(vs_id);
+  glDeleteShader(fs_id);
+
+  GLint success;
+  glGetProgramiv(shader_id, GL_LINK_STATUS, &success);
+  if (!success)
+  {
+    GLchar info_log[1024];
+    glGetProgramInfoLog(shader_id, sizeof(info_log), nullptr, info_log);
+    throw std::runtime_error(std::string("Shader Program Error:\n") +
+                             info_log);
+  }
+
+  shader_cache.store(shader_id, key);
+}
+
+void WallRenderer::create_pixel_data_tex()
+{
+  GLint max_layers = 0;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+  if (count > uint32_t(max_layers))
+  {
+    throw std::runtime_error("At most " + std::to_string(max_layers) +
+                             " machines fit into a texture array");
+  }
+
+  glGenTextures(1, &pixel_data_tex_id);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, pixel_data_tex_id);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R8, display_width,
+                 display_height, count);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  // Every layer starts out blank
+  const std::vector<byte_t> blank(size_t(count) * framebuffer_size);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                  0,
+                  0,
+                  0,
+                  0,
+                  display_width,
+                  display_height,
+                  count,
+                  GL_RED,
+                  GL_UNSIGNED_BYTE,
+                  blank.data());
+}
+
+void WallRenderer::terminate()
+{
+  glDeleteProgram(shader_id);
+  glDeleteVertexArrays(1, &vao_id);
+  glDeleteBuffers(1, &pixel_buffer_id);
+  glDeleteTextures(1, &pixel_data_tex_id);
+}
+
+} // namespace Chip8
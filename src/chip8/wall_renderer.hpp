@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "cpu_state.hpp"
+#include "glfw_window.hpp"
+#include "shader_cache.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief Draws the framebuffers of many machines as a grid in one window,
+ * e.g. all instances of a VecEnv.
+ *
+ * Every machine is a layer of one texture array, and the whole grid is a
+ * single instanced draw call. Only the rows the machines drew to get
+ * uploaded, as reported by the emulator: they are packed into one pixel
+ * buffer per frame and copied into the layers from there. The upload work
+ * follows the number of changed rows, not the number of pixels.
+ */
+class WallRenderer
+{
+public:
+  struct Statistics
+  {
+    uint64_t frames = 0;
+
+    /**
+     * Rows uploaded, the ones the machines drew to.
+     */
+    uint64_t changed_rows = 0;
+
+    /**
+     * Texture uploads, one per run of changed rows of a machine.
+     */
+    uint64_t uploads = 0;
+  };
+
+  /**
+   * @param count Number of machines to show
+   */
+  WallRenderer(std::shared_ptr<GlfwWindow> glfw_window, uint32_t count);
+
+  /**
+   * Create the window and the GL objects.
+   *
+   * Throws a exception if the texture array can not have a layer per
+   * machine.
+   */
+  void create_window();
+
+  /**
+   * Upload the changed rows and draw the grid. The layers start out blank.
+   *
+   * @param framebuffers Framebuffer of the first machine
+   * @param stride       Bytes from one framebuffer to the next
+   * @param dirty_rows   Rows changed since the last call, one mask per
+   *                     machine with bit n for row n, see VecEnv
+   */
+  void render(const byte_t   *framebuffers,
+              size_t          stride,
+              const uint32_t *dirty_rows);
+
+  void terminate();
+
+  const Statistics &get_statistics() const { return statistics; }
+
+private:
+  struct Upload
+  {
+    uint32_t layer;
+    uint32_t row;
+    uint32_t rows;
+    size_t   offset;
+  };
+
+  std::shared_ptr<GlfwWindow> glfw_window{};
+
+  const uint32_t count;
+
+  ShaderCache shader_cache{ShaderCache::get_default_directory()};
+
+  uint32_t shader_id{};
+  uint32_t vao_id{};
+  uint32_t pixel_data_tex_id{};
+  uint32_t pixel_buffer_id{};
+
+  /**
+   * Grid for the window size it was computed for.
+   */
+  int32_t layout_width  = -1;
+  int32_t layout_height = -1;
+  int32_t columns       = 1;
+  float   cell_size     = 0.0f;
+
+  /**
+   * Changed rows of the current frame, back to back.
+   */
+  std::vector<byte_t> staging{};
+  std::vector<Upload> uploads{};
+
+  Statistics statistics{};
+
+  void load_shaders();
+
+  void create_pixel_data_tex();
+
+  /**
+   * Pick the number of columns that gives the largest cells, if the window
+   * size changed.
+   */
+  void update_layout();
+
+  void upload_changes(const byte_t   *framebuffers,
+                      size_t          stride,
+                      const uint32_t *dirty_rows);
+};
+
+} // namespace Chip8
@@ -12,6 +12,11 @@ public:
 
   virtual void flush() = 0;
 
+  /**
+   * Rate at which the display shows frames, in Hz.
+   */
+  virtual double get_refresh_rate() const = 0;
+
   virtual void terminate() = 0;
 };
 
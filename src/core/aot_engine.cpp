@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "aot_engine.hpp"
+#include "cpu.hpp"
+#include "interpreter.hpp"
+
+namespace Chip8
+{
+
+AotEngine::AotEngine(const AotModule &module, const Cpu &cpu) : module(module)
+{
+  if (module.version != aot_module_version)
+  {
+    throw std::runtime_error("Recompiled module has a incompatible version");
+  }
+
+  const auto    &memory        = cpu.get_state().memory;
+  const uint32_t program_start = 0x200;
+  if (program_start + module.program_size > memory_size ||
+      hash_program(&memory[program_start], module.program_size) !=
+          module.program_hash)
+  {
+    throw std::runtime_error(
+        "Recompiled module does not match the loaded program");
+  }
+
+  runtime.execute_instruction = [](Cpu &cpu, dbyte_t opcode) {
+    cpu.execute_instruction(opcode);
+  };
+
+  for (uint32_t i = 0; i < module.block_count; ++i)
+  {
+    const AotBlock &block = module.blocks[i];
+
+    code_begin = std::min<uint32_t>(code_begin, block.address);
+    code_end   = std::max<uint32_t>(code_end, block.address + block.length * 2);
+  }
+
+  flush(cpu);
+}
+
+void AotEngine::flush(const Cpu &cpu)
+{
+  block_index.fill(no_block);
+
+  // The recompiled blocks are only valid as long as the program is intact
+  const auto &memory = cpu.get_state().memory;
+  if (hash_program(&memory[0x200], module.program_size) != module.program_hash)
+  {
+    return;
+  }
+
+  for (uint32_t i = 0; i < module.block_count; ++i)
+  {
+    block_index[module.blocks[i].address] = i;
+  }
+}
+
+void AotEngine::invalidate(const Cpu &cpu, uint32_t address, uint32_t size)
+{
+  // Blocks dropped after writes to the code may match the program again
+  if (address < code_end && code_begin < address + size)
+  {
+    flush(cpu);
+  }
+}
+
+uint32_t AotEngine::get_block_length(const Cpu &cpu)
+{
+  const dbyte_t pc = cpu.get_state().pc_register;
+  const int16_t index =
+      pc < block_index.size() ? block_index[pc] : no_block;
+
+  return index != no_block ? module.blocks[index].length : 1;
+}
+
+void AotEngine::run(Cpu &cpu, uint32_t cycles)
+{
+  CpuState &state = cpu.state;
+
+  while (cycles > 0 && !state.paused)
+  {
+    const dbyte_t pc = state.pc_register;
+    const int16_t index =
+        pc < block_index.size() ? block_index[pc] : no_block;
+
+    if (index != no_block && module.blocks[index].length <= cycles)
+    {
+      const AotBlock &block = module.blocks[index];
+      block.function(runtime, cpu, state);
+
+      cycles        -= block.length;
+      native_cycles += block.length;
+
+      invalidate_blocks(state.i_register, get_store_size(block.last_opcode));
+    }
+    else
+    {
+      const dbyte_t opcode = fetch_opcode(state);
+      cpu.cycle();
+
+      --cycles;
+      ++interpreted_cycles;
+
+      invalidate_blocks(state.i_register, get_store_size(opcode));
+    }
+  }
+}
+
+void AotEngine::invalidate_blocks(uint32_t address, uint32_t size)
+{
+  // Stores that wrap around only reach the sprites at the start of memory,
+  // never the code
+  address = mask_address(address);
+
+  if (size == 0 || address >= code_end || address + size <= code_begin)
+  {
+    return;
+  }
+
+  // Self modifying code. The recompiled blocks still contain the old
+  // instructions, so the interpreter has to take over for them.
+  for (uint32_t i = 0; i < module.block_count; ++i)
+  {
+    const AotBlock &block = module.blocks[i];
+    if (address < block.address + block.length * 2u &&
+        block.address < address + size)
+    {
+      block_index[block.address] = no_block;
+    }
+  }
+}
+
+} // namespace Chip8
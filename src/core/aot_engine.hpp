@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "aot_module.hpp"
+#include "engine.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief Runs a program recompiled by chip8_aot.
+ *
+ * Whenever the program counter points to the start of a recompiled basic
+ * block, the block runs as native code. Everything else, e.g. targets of
+ * indirect jumps, is interpreted. Blocks whose code gets overwritten by
+ * the program are dropped and interpreted from then on.
+ */
+class AotEngine : public Engine
+{
+public:
+  /**
+   * Throws a exception if the module does not match the program loaded
+   * into cpu.
+   */
+  AotEngine(const AotModule &module, const Cpu &cpu);
+
+  void run(Cpu &cpu, uint32_t cycles) override;
+
+  void flush(const Cpu &cpu) override;
+
+  void invalidate(const Cpu &cpu, uint32_t address, uint32_t size) override;
+
+  uint32_t get_block_length(const Cpu &cpu) override;
+
+  uint64_t get_native_cycles() const { return native_cycles; }
+
+  uint64_t get_interpreted_cycles() const { return interpreted_cycles; }
+
+private:
+  static constexpr int16_t no_block = -1;
+
+  const AotModule &module;
+
+  AotRuntime runtime{};
+
+  /**
+   * Index of the block starting at each address.
+   */
+  std::array<int16_t, 4096> block_index{};
+
+  /**
+   * Address range covered by recompiled code.
+   */
+  uint32_t code_begin = 0xFFFF;
+  uint32_t code_end   = 0;
+
+  uint64_t native_cycles      = 0;
+  uint64_t interpreted_cycles = 0;
+
+  void invalidate_blocks(uint32_t address, uint32_t size);
+};
+
+} // namespace Chip8
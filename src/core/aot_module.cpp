@@ -0,0 +1,38 @@
+#include <dlfcn.h>
+#include <stdexcept>
+
+#include "aot_module.hpp"
+
+namespace Chip8
+{
+
+uint32_t hash_program(const byte_t *program, uint32_t size)
+{
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < size; ++i)
+  {
+    hash ^= program[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+const AotModule &load_aot_module(const std::string &filepath)
+{
+  void *library = dlopen(filepath.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!library)
+  {
+    throw std::runtime_error(std::string("Could not load ") + dlerror());
+  }
+
+  const auto module =
+      static_cast<const AotModule *>(dlsym(library, "chip8_aot_module"));
+  if (!module)
+  {
+    throw std::runtime_error(filepath + " is not a chip8_aot module");
+  }
+
+  return *module;
+}
+
+} // namespace Chip8
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu_state.hpp"
+
+namespace Chip8
+{
+
+class Cpu;
+
+/**
+ * Bumped whenever the interface between the core and recompiled code
+ * changes. Modules built for another version get rejected.
+ */
+constexpr uint32_t aot_module_version = 2;
+
+/**
+ * @brief Helpers of the core that recompiled code calls back into.
+ */
+struct AotRuntime
+{
+  /**
+   * Execute a single instruction with the interpreter. The program counter
+   * has to point to the instruction.
+   */
+  void (*execute_instruction)(Cpu &cpu, dbyte_t opcode);
+};
+
+/**
+ * Runs a basic block. Leaves the program counter at the next instruction
+ * that has to be executed.
+ */
+using AotBlockFunction = void (*)(const AotRuntime &runtime,
+                                  Cpu              &cpu,
+                                  CpuState         &state);
+
+struct AotBlock
+{
+  /**
+   * Address of the first instruction.
+   */
+  dbyte_t address;
+
+  /**
+   * Number of instructions, which is also the number of cycles the block
+   * takes.
+   */
+  dbyte_t length;
+
+  /**
+   * Opcode of the last instruction. Used to detect writes to the code.
+   */
+  dbyte_t last_opcode;
+
+  AotBlockFunction function;
+};
+
+/**
+ * @brief A program recompiled ahead of time by chip8_aot.
+ */
+struct AotModule
+{
+  uint32_t version;
+
+  /**
+   * Hash and size of the program the module was built from.
+   */
+  uint32_t program_hash;
+  uint32_t program_size;
+
+  uint32_t        block_count;
+  const AotBlock *blocks;
+};
+
+/**
+ * Hash a program (FNV-1a). Used to check that a module matches the loaded
+ * program.
+ */
+uint32_t hash_program(const byte_t *program, uint32_t size);
+
+inline uint32_t hash_program(const std::vector<byte_t> &program)
+{
+  return hash_program(program.data(), program.size());
+}
+
+/**
+ * Load a module built by chip8_aot from a shared library. The library stays
+ * loaded until the process exits.
+ *
+ * Throws a exception if the library can not be loaded or is no module.
+ */
+const AotModule &load_aot_module(const std::string &filepath);
+
+} // namespace Chip8
@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <atomic>
+#include <bits/stdint-uintn.h>
+#include <cstdint>
+#include <stdexcept>
+
+#include "cpu.hpp"
+#include "interpreter.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+/**
+ * Seed for a new cpu. Only the first one asks the operating system, a
+ * std::random_device per cpu opens /dev/urandom every time.
+ */
+uint32_t next_seed()
+{
+  static const uint32_t        base = std::random_device()();
+  static std::atomic<uint32_t> count{0};
+
+  return base + count.fetch_add(1, std::memory_order_relaxed) * 0x9E3779B9u;
+}
+
+/**
+ * Whether the instruction is going to change a pixel. Sprites wrap around
+ * and every set bit flips a pixel, so a draw changes the display unless its
+ * rows are all zero, and a clear unless the display is clear already.
+ */
+bool changes_display(const CpuState &state, dbyte_t opcode)
+{
+  if (opcode == 0x00E0)
+  {
+    for (const auto &row : state.framebuffer)
+    {
+      for (const auto pixel : row)
+      {
+        if (pixel)
+        {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  if ((opcode & 0xF000) != 0xD000)
+  {
+    return false;
+  }
+
+  const uint32_t address = mask_address(state.i_register);
+  for (uint32_t row = 0; row < (opcode & 0xFu); ++row)
+  {
+    if (state.memory[address + row])
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+Cpu::Cpu(std::unique_ptr<Keyboard> keyboard) : keyboard(std::move(keyboard))
+{
+  state.random_engine.seed(next_seed());
+}
+
+void Cpu::init() { load_sprites(); }
+
+void Cpu::load_program(const byte_t *program, size_t size)
+{
+  for (size_t i = 0; i < size; ++i)
+  {
+    if (program_start + i >= memory_size)
+    {
+      throw std::runtime_error("Program is to long");
+    }
+
+    state.memory[program_start + i] = program[i];
+  }
+
+  if (engine)
+  {
+    engine->flush(*this);
+  }
+}
+
+void Cpu::replace_program(const std::vector<byte_t> &program,
+                          size_t                     old_size)
+{
+  if (program.size() > memory_size - program_start)
+  {
+    throw std::runtime_error("Program is to long");
+  }
+
+  const size_t space = memory_size - program_start;
+  std::fill_n(state.memory.begin() + program_start,
+              std::min(old_size, space), 0);
+  std::copy(program.begin(), program.end(),
+            state.memory.begin() + program_start);
+
+  if (engine)
+  {
+    engine->flush(*this);
+  }
+}
+
+void Cpu::set_state(const CpuState &new_state)
+{
+  if (!engine)
+  {
+    state = new_state;
+    return;
+  }
+
+  // Range of memory that changes, the guard mirrors the start
+  const auto begin = state.memory.begin();
+  const auto end   = begin + memory_size;
+  const auto first = std::mismatch(begin, end, new_state.memory.begin()).first;
+
+  uint32_t size = 0;
+  if (first != end)
+  {
+    auto last = end;
+    while (*(last - 1) == new_state.memory[last - 1 - begin])
+    {
+      --last;
+    }
+    size = last - first;
+  }
+
+  const uint32_t address = first - begin;
+  state                  = new_state;
+
+  if (size > 0)
+  {
+    engine->invalidate(*this, address, size);
+  }
+}
+
+void Cpu::cycle()
+{
+  if (tracer)
+  {
+    traced_cycle();
+    return;
+  }
+
+  Chip8::cycle(state, *keyboard);
+}
+
+void Cpu::traced_cycle()
+{
+  if (state.paused)
+  {
+    return;
+  }
+
+  const dbyte_t pc     = state.pc_register;
+  const dbyte_t opcode = get_next_instruction();
+  execute_instruction(opcode);
+  increase_program_counter();
+  update_timers();
+
+  tracer->record(pc, opcode, state);
+}
+
+void Cpu::run(uint32_t cycles)
+{
+  if (engine && !tracer)
+  {
+    engine->run(*this, cycles);
+    return;
+  }
+
+  for (uint32_t i = 0; i < cycles; ++i)
+  {
+    cycle();
+  }
+}
+
+RunUntilResult Cpu::run_until(uint32_t max_cycles, RunEvent events)
+{
+  events = events | RunEvent::CycleBudget | RunEvent::KeyWait;
+
+  return tracer ? run_until<true>(max_cycles, events)
+                : run_until<false>(max_cycles, events);
+}
+
+template <bool traced>
+RunUntilResult Cpu::run_until(uint32_t max_cycles, RunEvent events)
+{
+  RunUntilResult result;
+
+  // Counters live in locals, the keyboard call in the loop would force
+  // members back to memory every cycle
+  uint32_t cycles   = 0;
+  uint32_t position = frame_position;
+
+  while (!state.paused && cycles < max_cycles)
+  {
+    const dbyte_t pc          = state.pc_register;
+    const dbyte_t opcode      = fetch_opcode(state);
+    const bool    was_playing = state.sound_delay_register > 0;
+    const bool    draw        = changes_display(state, opcode);
+
+    interpret(state, opcode, *keyboard);
+    state.pc_register += 2;
+
+    // Before the tick, FX18 with 1 starts a sound the tick ends at once
+    const bool started = !was_playing && state.sound_delay_register > 0;
+    Chip8::update_timers(state);
+    const bool stopped =
+        (was_playing || started) && state.sound_delay_register == 0;
+
+    if (traced)
+    {
+      tracer->record(pc, opcode, state);
+    }
+
+    ++cycles;
+
+    const bool frame_end = ++position == cycles_per_frame;
+    if (!frame_end && !draw && !started && !stopped && !state.paused &&
+        cycles < max_cycles)
+    {
+      continue;
+    }
+
+    uint32_t happened = 0;
+    if (cycles == max_cycles)
+    {
+      happened |= uint32_t(RunEvent::CycleBudget);
+    }
+    if (frame_end)
+    {
+      position = 0;
+      ++result.frames;
+      happened |= uint32_t(RunEvent::VBlank);
+    }
+    if (draw)
+    {
+      ++result.draws;
+      happened |= uint32_t(RunEvent::DisplayChange);
+    }
+    if (started)
+    {
+      happened |= uint32_t(RunEvent::SoundStart);
+    }
+    if (stopped)
+    {
+      happened |= uint32_t(RunEvent::SoundStop);
+    }
+    if (state.paused)
+    {
+      happened |= uint32_t(RunEvent::KeyWait);
+    }
+
+    result.events = RunEvent(happened) & events;
+    if (result.events != RunEvent::None)
+    {
+      break;
+    }
+  }
+
+  result.cycles  = cycles;
+  frame_position = position;
+
+  if (result.events == RunEvent::None)
+  {
+    // Waiting for a key already, or no budget at all
+    result.events = state.paused ? RunEvent::KeyWait : RunEvent::CycleBudget;
+  }
+  return result;
+}
+
+void Cpu::load_sprites()
+{
+  // Array of hex values for each sprite. Each sprite is 5 bytes.
+  // The technical reference provides us with each one of these values.
+  const std::array<byte_t, 80> sprites = {
+      0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+      0x20, 0x60, 0x20, 0x20, 0x70, // 1
+      0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+      0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+      0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+      0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+      0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+      0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+      0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+      0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+      0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+      0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+      0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+      0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+      0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+      0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+  };
+
+  // According to the technical reference, sprites are stored in the
+  // interpreter section of memory starting at hex 0x000
+  for (uint32_t i = 0; i < sprites.size(); i++)
+  {
+    state.memory[i] = sprites[i];
+  }
+  update_memory_guard(state.memory);
+}
+
+dbyte_t Cpu::get_next_instruction() { return fetch_opcode(state); }
+
+void Cpu::increase_program_counter() { state.pc_register += 2; }
+
+void Cpu::execute_instruction(const dbyte_t opcode)
+{
+  interpret(state, opcode, *keyboard);
+}
+
+void Cpu::update_timers() { Chip8::update_timers(state); }
+
+} // namespace Chip8
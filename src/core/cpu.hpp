@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "cpu_state.hpp"
+#include "engine.hpp"
+#include "keyboard.hpp"
+#include "trace.hpp"
+
+namespace Chip8
+{
+
+/**
+ * Events Cpu::run_until() stops at, as bits of a mask.
+ */
+enum class RunEvent : uint32_t
+{
+  None = 0,
+
+  /**
+   * The requested number of cycles ran. Always stops the run.
+   */
+  CycleBudget = 1 << 0,
+
+  /**
+   * A frame of cycles, see Cpu::set_cycles_per_frame(), is complete.
+   */
+  VBlank = 1 << 1,
+
+  /**
+   * An instruction changed at least one pixel. Drawing an empty sprite or
+   * clearing a clear display does not count.
+   */
+  DisplayChange = 1 << 2,
+
+  /**
+   * FX0A waits for a key. Always stops the run, since nothing runs while
+   * waiting.
+   */
+  KeyWait = 1 << 3,
+
+  /**
+   * The sound timer got set, or ran out. Both in the same cycle when FX18
+   * sets it to 1, since the timer ticks right after the instruction.
+   */
+  SoundStart = 1 << 4,
+  SoundStop  = 1 << 5,
+
+  All = (1 << 6) - 1
+};
+
+inline RunEvent operator|(RunEvent a, RunEvent b)
+{
+  return RunEvent(uint32_t(a) | uint32_t(b));
+}
+
+inline RunEvent operator&(RunEvent a, RunEvent b)
+{
+  return RunEvent(uint32_t(a) & uint32_t(b));
+}
+
+struct RunUntilResult
+{
+  /**
+   * Requested events that happened in the last cycle. More than one if they
+   * coincide, e.g. a draw at the end of a frame.
+   */
+  RunEvent events = RunEvent::None;
+
+  uint32_t cycles = 0;
+
+  /**
+   * Frames completed.
+   */
+  uint32_t frames = 0;
+
+  /**
+   * Instructions that changed the display.
+   */
+  uint32_t draws = 0;
+};
+
+/**
+ * @brief The cpu of the chip8 simulator.
+ *
+ * This is the place where the memory lives and the instructions get
+ * executed. A description of the chip8 architecture can be found on
+ * http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#2.2
+ */
+class Cpu
+{
+public:
+  Cpu(std::unique_ptr<Keyboard> keyboard);
+
+  /**
+   * Init the cpu. Load sprites.
+   */
+  void init();
+
+  /**
+   * Load a program into the cpu memory.
+   *
+   * Throws a exception if the program is to long.
+   *
+   * @param program Program to load
+   */
+  void load_program(const std::vector<byte_t> &program)
+  {
+    load_program(program.data(), program.size());
+  }
+
+  void load_program(const byte_t *program, size_t size);
+
+  /**
+   * Replace a loaded program by a new version of it. Registers, timers,
+   * the framebuffer and memory outside of the program are kept, so a
+   * running program picks up the new code where it is.
+   *
+   * Throws a exception if the program is to long, the state is left as is
+   * then.
+   *
+   * @param program  New version of the program
+   * @param old_size Size of the program loaded before, the part the new
+   *                 version does not cover gets cleared
+   */
+  void replace_program(const std::vector<byte_t> &program, size_t old_size);
+
+  /**
+   * Run one cpu cycle.
+   */
+  void cycle();
+
+  /**
+   * Run a number of cpu cycles. Uses the engine if one is set, unless a
+   * tracer is set, which needs the interpreter.
+   */
+  void run(uint32_t cycles);
+
+  /**
+   * Run cycles until one of the events happens, without returning to the
+   * caller in between. A frontend can present and read input whenever this
+   * returns. Uses the interpreter, since engines run blind batches.
+   *
+   * @param max_cycles Cycle budget
+   * @param events     Events to stop at besides the budget and key waits
+   */
+  RunUntilResult run_until(uint32_t max_cycles, RunEvent events);
+
+  /**
+   * Length of a frame for RunEvent::VBlank. The timers tick every cycle, so
+   * by default every cycle is a frame. Frames are only counted by
+   * run_until().
+   */
+  void set_cycles_per_frame(uint32_t cycles)
+  {
+    cycles_per_frame = std::max(1u, cycles);
+    frame_position   = 0;
+  }
+
+  /**
+   * Replace the interpreter by a different engine. Pass nullptr to go back
+   * to the interpreter.
+   */
+  void set_engine(std::unique_ptr<Engine> new_engine)
+  {
+    engine = std::move(new_engine);
+  }
+
+  Engine *get_engine() const { return engine.get(); }
+
+  /**
+   * Record every executed instruction. Pass nullptr to stop tracing.
+   */
+  void set_tracer(std::unique_ptr<Tracer> new_tracer)
+  {
+    tracer = std::move(new_tracer);
+  }
+
+  Tracer *get_tracer() const { return tracer.get(); }
+
+  bool is_paused() { return state.paused; }
+
+  const Framebuffer &get_framebuffer() const { return state.framebuffer; }
+
+  /**
+   * Get the complete state of the cpu. Together with set_state() this can
+   * be used to save and restore the machine.
+   */
+  const CpuState &get_state() const { return state; }
+
+  /**
+   * Only the memory that differs from the current one gets invalidated in
+   * the engine, so that restoring a snapshot, e.g. for run-ahead, keeps
+   * what the engine cached about the code.
+   */
+  void set_state(const CpuState &new_state);
+
+private:
+  friend class AotEngine;
+  friend class Debugger;
+  friend class FusionEngine;
+
+  const dbyte_t program_start = 0x200;
+
+  CpuState state{};
+
+  std::unique_ptr<Keyboard> keyboard{};
+
+  std::unique_ptr<Engine> engine{};
+
+  std::unique_ptr<Tracer> tracer{};
+
+  uint32_t cycles_per_frame = 1;
+
+  /**
+   * Cycles of the current frame that ran.
+   */
+  uint32_t frame_position = 0;
+
+  void load_sprites();
+
+  dbyte_t get_next_instruction();
+
+  void increase_program_counter();
+
+  void execute_instruction(const dbyte_t opcode);
+
+  void update_timers();
+
+  /**
+   * Kept out of cycle(), so that the cycles without a tracer stay lean.
+   */
+  void traced_cycle();
+
+  /**
+   * run_until() with the tracer check out of the loop.
+   */
+  template <bool traced>
+  RunUntilResult run_until(uint32_t max_cycles, RunEvent events);
+};
+
+} // namespace Chip8
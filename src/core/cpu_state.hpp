@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <type_traits>
+
+#include "framebuffer.hpp"
+
+namespace Chip8
+{
+
+using byte_t  = unsigned char;
+using dbyte_t = unsigned short;
+
+constexpr uint32_t memory_size = 4096;
+
+/**
+ * Bytes after the end of flat memory that mirror the first ones. An access
+ * of up to 16 bytes starting at a masked address can run straight into
+ * them and sees the same bytes as if it wrapped around.
+ */
+constexpr uint32_t memory_guard_size = 16;
+
+/**
+ * Addresses are 12 bits wide. Every access starts at a masked address, so
+ * no program can reach outside of memory.
+ */
+inline uint32_t mask_address(uint32_t address)
+{
+  return address & (memory_size - 1);
+}
+
+/**
+ * 4096 bytes of memory, owned by a single machine, followed by the guard.
+ */
+using FlatMemory = std::array<byte_t, memory_size + memory_guard_size>;
+
+inline void write_memory(FlatMemory &memory, uint32_t address, byte_t value)
+{
+  address         = mask_address(address);
+  memory[address] = value;
+
+  // Refresh the mirror of the byte in the guard. Writing it always is
+  // cheaper than checking whether the write hit the start of memory.
+  const uint32_t mirrored       = address % memory_guard_size;
+  memory[memory_size + mirrored] = memory[mirrored];
+}
+
+/**
+ * Copy the start of memory into the guard, after writing flat memory
+ * directly instead of through write_memory().
+ */
+inline void update_memory_guard(FlatMemory &memory)
+{
+  std::copy(memory.begin(), memory.begin() + memory_guard_size,
+            memory.begin() + memory_size);
+}
+
+/**
+ * @brief Complete architectural state of the chip8.
+ *
+ * The memory model is a parameter, so that batches of machines can share
+ * memory, see SharedMemory. The interpreter works with any of them.
+ */
+template <typename Memory> struct BasicCpuState
+{
+  /**
+   * 4096 bytes of memory.
+   */
+  Memory memory{};
+
+  /**
+   * 16 8-bit registers.
+   */
+  std::array<byte_t, 16> v_registers{};
+
+  /**
+   * Register for storing memory addresses.
+   */
+  dbyte_t i_register{};
+
+  /**
+   * Timer delay register.
+   */
+  byte_t timer_delay_register{};
+
+  /**
+   * Sound timer register.
+   */
+  byte_t sound_delay_register{};
+
+  /**
+   * Stack pointer register.
+   */
+  byte_t sp_register{};
+
+  /**
+   * Program counter register.
+   */
+  dbyte_t pc_register = 0x200;
+
+  /**
+   * Stack.
+   */
+  std::array<dbyte_t, 16> stack{};
+
+  bool paused = false;
+
+  std::default_random_engine random_engine{};
+
+  Framebuffer framebuffer{};
+};
+
+/**
+ * State with flat memory. Everything a program can observe lives in here
+ * and nothing in here owns a resource, so a state can be saved and
+ * restored by a plain copy.
+ */
+using CpuState = BasicCpuState<FlatMemory>;
+
+// Restoring a state has to stay a plain memcpy, e.g. for resetting the
+// machine between fuzz runs
+static_assert(std::is_trivially_copyable<CpuState>::value,
+              "CpuState must be trivially copyable");
+
+} // namespace Chip8
@@ -0,0 +1,421 @@
+#include <cctype>
+#include <cstdio>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#include "cpu.hpp"
+#include "debugger.hpp"
+#include "disassembler.hpp"
+#include "interpreter.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+/**
+ * First watched access of an instruction.
+ */
+struct WatchHit
+{
+  Debugger::StopReason reason  = Debugger::StopReason::None;
+  uint32_t             address = 0;
+};
+
+/**
+ * Memory as the interpreter sees it while debugging. Accesses go to the
+ * memory of the cpu and get checked against the watchpoints on the way.
+ */
+class WatchedMemory
+{
+public:
+  WatchedMemory() = default;
+
+  WatchedMemory(FlatMemory                            &memory,
+                const std::array<byte_t, memory_size> &watched,
+                WatchHit                              &hit)
+      : memory(&memory), watched(&watched), hit(&hit)
+  {
+  }
+
+  byte_t operator[](uint32_t address) const
+  {
+    note(address, Debugger::watch_read, Debugger::StopReason::ReadWatchpoint);
+    return (*memory)[address];
+  }
+
+  void write(uint32_t address, byte_t value)
+  {
+    note(address, Debugger::watch_write,
+         Debugger::StopReason::WriteWatchpoint);
+    Chip8::write_memory(*memory, address, value);
+  }
+
+private:
+  FlatMemory                            *memory{};
+  const std::array<byte_t, memory_size> *watched{};
+  WatchHit                              *hit{};
+
+  void note(uint32_t address, byte_t access, Debugger::StopReason reason) const
+  {
+    address = mask_address(address);
+    if (((*watched)[address] & access) &&
+        hit->reason == Debugger::StopReason::None)
+    {
+      hit->reason  = reason;
+      hit->address = address;
+    }
+  }
+};
+
+void write_memory(WatchedMemory &memory, uint32_t address, byte_t value)
+{
+  memory.write(address, value);
+}
+
+using WatchedCpuState = BasicCpuState<WatchedMemory>;
+
+/**
+ * Copy everything but the memory.
+ */
+template <typename To, typename From>
+void copy_registers(To &to, const From &from)
+{
+  to.v_registers          = from.v_registers;
+  to.i_register           = from.i_register;
+  to.timer_delay_register = from.timer_delay_register;
+  to.sound_delay_register = from.sound_delay_register;
+  to.sp_register          = from.sp_register;
+  to.pc_register          = from.pc_register;
+  to.stack                = from.stack;
+  to.paused               = from.paused;
+  to.random_engine        = from.random_engine;
+  to.framebuffer          = from.framebuffer;
+}
+
+const char *const register_names[] = {"V0", "V1", "V2", "V3", "V4", "V5",
+                                      "V6", "V7", "V8", "V9", "VA", "VB",
+                                      "VC", "VD", "VE", "VF", "I",  "DT",
+                                      "ST"};
+
+const char *const comparison_names[] = {"==", "!=", "<", "<=", ">", ">="};
+
+} // namespace
+
+RegisterCondition parse_register_condition(const std::string &text)
+{
+  std::istringstream in(text);
+
+  std::string name;
+  std::string comparison;
+  std::string value;
+  std::string rest;
+  if (!(in >> name >> comparison >> value) || in >> rest)
+  {
+    throw std::runtime_error("Condition needs the form REGISTER OP VALUE: " +
+                             text);
+  }
+
+  for (char &c : name)
+  {
+    c = std::toupper(static_cast<unsigned char>(c));
+  }
+
+  RegisterCondition condition;
+
+  bool found = false;
+  for (size_t i = 0; i < std::size(register_names); ++i)
+  {
+    if (name == register_names[i])
+    {
+      condition.reg = static_cast<RegisterCondition::Register>(i);
+      found         = true;
+    }
+  }
+  if (!found)
+  {
+    throw std::runtime_error("Unknown register " + name);
+  }
+
+  found = false;
+  for (size_t i = 0; i < std::size(comparison_names); ++i)
+  {
+    if (comparison == comparison_names[i])
+    {
+      condition.comparison = static_cast<RegisterCondition::Comparison>(i);
+      found                = true;
+    }
+  }
+  if (!found)
+  {
+    throw std::runtime_error("Unknown comparison " + comparison);
+  }
+
+  size_t end      = 0;
+  condition.value = std::stoul(value, &end, 0);
+  if (end != value.size())
+  {
+    throw std::runtime_error("Invalid value " + value);
+  }
+
+  return condition;
+}
+
+std::string to_string(const RegisterCondition &condition)
+{
+  char text[32];
+  std::snprintf(text, sizeof(text), "%s %s 0x%X",
+                register_names[static_cast<byte_t>(condition.reg)],
+                comparison_names[static_cast<byte_t>(condition.comparison)],
+                condition.value);
+  return text;
+}
+
+void Debugger::run(Cpu &cpu, uint32_t cycles)
+{
+  if (stopped)
+  {
+    return;
+  }
+
+  CpuState &state    = cpu.state;
+  Keyboard &keyboard = *cpu.keyboard;
+
+  WatchHit        hit;
+  WatchedCpuState debug_state;
+  copy_registers(debug_state, state);
+  debug_state.memory = WatchedMemory(state.memory, watched, hit);
+
+  if (!conditions_primed)
+  {
+    for (size_t i = 0; i < conditions.size(); ++i)
+    {
+      conditions_held[i] = conditions[i].holds(debug_state);
+    }
+    conditions_primed = true;
+  }
+
+  for (; cycles > 0 && !debug_state.paused && !stopped; --cycles)
+  {
+    const uint32_t pc = mask_address(debug_state.pc_register);
+    if (breakpoints[pc] && !skip_breakpoint)
+    {
+      stop(StopReason::Breakpoint, pc);
+      break;
+    }
+    skip_breakpoint = false;
+
+    // Fetched past the watched memory, the guard covers pc + 1
+    const dbyte_t opcode = state.memory[pc] << 8 | state.memory[pc + 1];
+    interpret(debug_state, opcode, keyboard);
+    debug_state.pc_register += 2;
+    update_timers(debug_state);
+
+    if (hit.reason != StopReason::None)
+    {
+      stop(hit.reason, hit.address, pc);
+    }
+
+    for (size_t i = 0; i < conditions.size(); ++i)
+    {
+      const bool holds = conditions[i].holds(debug_state);
+      if (holds && !conditions_held[i] && !stopped)
+      {
+        stop(StopReason::Condition, pc, i);
+      }
+      conditions_held[i] = holds;
+    }
+
+    if (steps > 0 && --steps == 0 && !stopped)
+    {
+      stop(StopReason::Step, mask_address(debug_state.pc_register));
+    }
+  }
+
+  copy_registers(state, debug_state);
+
+  if (frame_step && !stopped)
+  {
+    stop(StopReason::Step, mask_address(state.pc_register));
+  }
+  frame_step = false;
+}
+
+void Debugger::set_breakpoint(dbyte_t address, bool enabled)
+{
+  breakpoints[mask_address(address)] = enabled;
+}
+
+std::vector<dbyte_t> Debugger::get_breakpoints() const
+{
+  std::vector<dbyte_t> addresses;
+  for (uint32_t address = 0; address < memory_size; ++address)
+  {
+    if (breakpoints[address])
+    {
+      addresses.push_back(address);
+    }
+  }
+  return addresses;
+}
+
+void Debugger::set_watchpoint(dbyte_t address, uint32_t size, byte_t access)
+{
+  for (uint32_t i = 0; i < size && i < memory_size; ++i)
+  {
+    watched[mask_address(address + i)] = access;
+  }
+}
+
+void Debugger::add_condition(const RegisterCondition &condition)
+{
+  conditions.push_back(condition);
+  conditions_held.push_back(false);
+  conditions_primed = false;
+}
+
+void Debugger::remove_condition(size_t index)
+{
+  if (index < conditions.size())
+  {
+    conditions.erase(conditions.begin() + index);
+    conditions_held.erase(conditions_held.begin() + index);
+  }
+}
+
+void Debugger::pause()
+{
+  if (!stopped)
+  {
+    stop(StopReason::Paused, stop_address);
+  }
+}
+
+void Debugger::resume()
+{
+  start();
+}
+
+void Debugger::step(uint32_t instructions)
+{
+  start();
+  steps = instructions;
+}
+
+void Debugger::step_frame()
+{
+  start();
+  frame_step = true;
+}
+
+void Debugger::start()
+{
+  stopped         = false;
+  stop_reason     = StopReason::None;
+  skip_breakpoint = true;
+  steps           = 0;
+  frame_step      = false;
+}
+
+void Debugger::stop(StopReason reason, uint32_t address, uint32_t argument)
+{
+  stopped       = true;
+  stop_reason   = reason;
+  stop_address  = address;
+  stop_argument = argument;
+  steps         = 0;
+  ++stop_count;
+}
+
+std::string Debugger::describe_stop() const
+{
+  char text[96];
+
+  switch (stop_reason)
+  {
+  case StopReason::None:
+    return "Running";
+
+  case StopReason::Paused:
+    return "Paused";
+
+  case StopReason::Breakpoint:
+    std::snprintf(text, sizeof(text), "Breakpoint at 0x%03X", stop_address);
+    break;
+
+  case StopReason::ReadWatchpoint:
+  case StopReason::WriteWatchpoint:
+    std::snprintf(text, sizeof(text),
+                  "%s watchpoint at 0x%03X by the instruction at 0x%03X",
+                  stop_reason == StopReason::ReadWatchpoint ? "Read" : "Write",
+                  stop_address, stop_argument);
+    break;
+
+  case StopReason::Condition:
+    std::snprintf(
+        text, sizeof(text), "Condition %u (%s) after the instruction at 0x%03X",
+        stop_argument,
+        stop_argument < conditions.size()
+            ? to_string(conditions[stop_argument]).c_str()
+            : "removed",
+        stop_address);
+    break;
+
+  case StopReason::Step:
+    std::snprintf(text, sizeof(text), "Stepped to 0x%03X", stop_address);
+    break;
+  }
+
+  return text;
+}
+
+std::string Debugger::disassemble_around(const CpuState &state,
+                                         uint32_t        before,
+                                         uint32_t        after) const
+{
+  std::string listing;
+  char        line[64];
+
+  const uint32_t pc = mask_address(state.pc_register);
+  for (uint32_t n = 0; n <= before + after; ++n)
+  {
+    const uint32_t address = mask_address(pc + 2 * n - 2 * before);
+    const dbyte_t  opcode =
+        state.memory[address] << 8 | state.memory[address + 1];
+
+    std::snprintf(line, sizeof(line), "%c%c 0x%03X  %04X  %s\n",
+                  address == pc ? '>' : ' ',
+                  breakpoints[address] ? '*' : ' ', address, opcode,
+                  disassemble(opcode).c_str());
+    listing += line;
+  }
+  return listing;
+}
+
+std::string format_registers(const CpuState &state)
+{
+  std::string text;
+  char        part[32];
+
+  for (uint32_t i = 0; i < 16; ++i)
+  {
+    std::snprintf(part, sizeof(part), "V%X=%02X%c", i, state.v_registers[i],
+                  i % 8 == 7 ? '\n' : ' ');
+    text += part;
+  }
+
+  std::snprintf(part, sizeof(part), "PC=0x%03X I=0x%03X ", state.pc_register,
+                state.i_register);
+  text += part;
+  std::snprintf(part, sizeof(part), "SP=%X DT=%02X ST=%02X",
+                state.sp_register & 0xF, state.timer_delay_register,
+                state.sound_delay_register);
+  text += part;
+  text += state.paused ? " waiting for a key\n" : "\n";
+
+  return text;
+}
+
+} // namespace Chip8
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu_state.hpp"
+#include "engine.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief Break when a register compares true to a value, e.g. V3 == 0x10.
+ */
+struct RegisterCondition
+{
+  /**
+   * V0 to VF are the values 0 to 15.
+   */
+  enum class Register : byte_t
+  {
+    V0,
+    VF = 15,
+    I,
+    DelayTimer,
+    SoundTimer
+  };
+
+  enum class Comparison : byte_t
+  {
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual
+  };
+
+  Register   reg        = Register::V0;
+  Comparison comparison = Comparison::Equal;
+  uint32_t   value      = 0;
+
+  template <typename State> bool holds(const State &state) const
+  {
+    uint32_t current = 0;
+    switch (reg)
+    {
+    case Register::I:
+      current = state.i_register;
+      break;
+
+    case Register::DelayTimer:
+      current = state.timer_delay_register;
+      break;
+
+    case Register::SoundTimer:
+      current = state.sound_delay_register;
+      break;
+
+    default:
+      current = state.v_registers[static_cast<byte_t>(reg)];
+      break;
+    }
+
+    switch (comparison)
+    {
+    case Comparison::Equal:
+      return current == value;
+    case Comparison::NotEqual:
+      return current != value;
+    case Comparison::Less:
+      return current < value;
+    case Comparison::LessEqual:
+      return current <= value;
+    case Comparison::Greater:
+      return current > value;
+    case Comparison::GreaterEqual:
+      return current >= value;
+    }
+    return false;
+  }
+};
+
+/**
+ * Parse a condition like "V3 == 0x10", "I >= 0x300" or "DT == 0". The
+ * registers are V0 to VF, I, DT and ST. Values are decimal or hex with 0x.
+ *
+ * Throws a exception if the text is no condition.
+ */
+RegisterCondition parse_register_condition(const std::string &text);
+
+std::string to_string(const RegisterCondition &condition);
+
+/**
+ * @brief Engine that runs the interpreter under the control of a debugger.
+ *
+ * All checks live in this engine, so the plain interpreter and the other
+ * engines run exactly as fast as without a debugger. Selecting it as the
+ * engine of a cpu is what attaches the debugger.
+ *
+ * While stopped, run() executes nothing and the timers stand still. The
+ * instruction fetch does not count as a read for watchpoints, breakpoints
+ * cover that.
+ */
+class Debugger : public Engine
+{
+public:
+  enum class StopReason : byte_t
+  {
+    None,
+    Paused,
+    Breakpoint,
+    ReadWatchpoint,
+    WriteWatchpoint,
+    Condition,
+    Step
+  };
+
+  /**
+   * Accesses a watchpoint breaks on.
+   */
+  static constexpr byte_t watch_read  = 1;
+  static constexpr byte_t watch_write = 2;
+
+  void run(Cpu &cpu, uint32_t cycles) override;
+
+  /**
+   * Stop before the instruction at the address executes.
+   */
+  void set_breakpoint(dbyte_t address, bool enabled);
+
+  std::vector<dbyte_t> get_breakpoints() const;
+
+  /**
+   * Stop after an instruction accessed one of the bytes. Access 0 removes
+   * the watchpoint.
+   *
+   * @param access watch_read, watch_write or both
+   */
+  void set_watchpoint(dbyte_t address, uint32_t size, byte_t access);
+
+  /**
+   * @return watch_read and watch_write bits for every byte of memory
+   */
+  const std::array<byte_t, memory_size> &get_watchpoints() const
+  {
+    return watched;
+  }
+
+  /**
+   * Stop after an instruction made the condition true. A condition that
+   * already holds has to turn false before it can stop the machine again.
+   */
+  void add_condition(const RegisterCondition &condition);
+
+  void remove_condition(size_t index);
+
+  const std::vector<RegisterCondition> &get_conditions() const
+  {
+    return conditions;
+  }
+
+  void pause();
+
+  /**
+   * Run until something stops the machine. A breakpoint at the current
+   * instruction does not stop it again.
+   */
+  void resume();
+
+  /**
+   * Run a number of instructions, then stop.
+   */
+  void step(uint32_t instructions = 1);
+
+  /**
+   * Run the cycles of the next run() call, which the simulator makes once
+   * per presented frame, then stop.
+   */
+  void step_frame();
+
+  bool is_stopped() const { return stopped; }
+
+  StopReason get_stop_reason() const { return stop_reason; }
+
+  /**
+   * Counts the stops, to notice a new one.
+   */
+  uint64_t get_stop_count() const { return stop_count; }
+
+  /**
+   * Why the machine stopped, e.g. "Write watchpoint at 0x3A0".
+   */
+  std::string describe_stop() const;
+
+  /**
+   * Instructions around the program counter, one per line. The next one to
+   * execute is marked by > and breakpoints by *.
+   */
+  std::string disassemble_around(const CpuState &state,
+                                 uint32_t        before,
+                                 uint32_t        after) const;
+
+private:
+  std::bitset<memory_size>        breakpoints{};
+  std::array<byte_t, memory_size> watched{};
+
+  std::vector<RegisterCondition> conditions{};
+
+  /**
+   * Whether each condition held after the last instruction. Filled in by
+   * the next run() after a condition got added.
+   */
+  std::vector<bool> conditions_held{};
+  bool              conditions_primed = false;
+
+  bool       stopped       = true;
+  StopReason stop_reason   = StopReason::Paused;
+  uint32_t   stop_address  = 0x200;
+  uint64_t   stop_count    = 0;
+  uint32_t   stop_argument = 0;
+
+  /**
+   * Set on resuming, so that the breakpoint the machine stopped at does not
+   * stop it right away again.
+   */
+  bool skip_breakpoint = false;
+
+  uint32_t steps      = 0;
+  bool     frame_step = false;
+
+  void stop(StopReason reason, uint32_t address, uint32_t argument = 0);
+
+  void start();
+};
+
+/**
+ * All registers on three lines.
+ */
+std::string format_registers(const CpuState &state);
+
+} // namespace Chip8
@@ -0,0 +1,134 @@
+#include <cstdio>
+
+#include "disassembler.hpp"
+
+namespace Chip8
+{
+
+std::string disassemble(dbyte_t opcode)
+{
+  const unsigned addr = opcode & 0xFFF;
+  const unsigned x    = (opcode & 0x0F00) >> 8;
+  const unsigned y    = (opcode & 0x00F0) >> 4;
+  const unsigned n    = opcode & 0xF;
+  const unsigned nn   = opcode & 0xFF;
+
+  char text[32];
+
+  const auto format = [&text](const char *format, auto... args) {
+    std::snprintf(text, sizeof(text), format, args...);
+    return std::string(text);
+  };
+
+  switch (opcode & 0xF000)
+  {
+  case 0x0000:
+    if (opcode == 0x00E0)
+    {
+      return "CLS";
+    }
+    if (opcode == 0x00EE)
+    {
+      return "RET";
+    }
+    return format("SYS 0x%03X", addr);
+
+  case 0x1000:
+    return format("JP 0x%03X", addr);
+
+  case 0x2000:
+    return format("CALL 0x%03X", addr);
+
+  case 0x3000:
+    return format("SE V%X, 0x%02X", x, nn);
+
+  case 0x4000:
+    return format("SNE V%X, 0x%02X", x, nn);
+
+  case 0x5000:
+    return format("SE V%X, V%X", x, y);
+
+  case 0x6000:
+    return format("LD V%X, 0x%02X", x, nn);
+
+  case 0x7000:
+    return format("ADD V%X, 0x%02X", x, nn);
+
+  case 0x8000:
+    switch (n)
+    {
+    case 0x0:
+      return format("LD V%X, V%X", x, y);
+    case 0x1:
+      return format("OR V%X, V%X", x, y);
+    case 0x2:
+      return format("AND V%X, V%X", x, y);
+    case 0x3:
+      return format("XOR V%X, V%X", x, y);
+    case 0x4:
+      return format("ADD V%X, V%X", x, y);
+    case 0x5:
+      return format("SUB V%X, V%X", x, y);
+    case 0x6:
+      return format("SHR V%X", x);
+    case 0x7:
+      return format("SUBN V%X, V%X", x, y);
+    case 0xE:
+      return format("SHL V%X", x);
+    }
+    break;
+
+  case 0x9000:
+    return format("SNE V%X, V%X", x, y);
+
+  case 0xA000:
+    return format("LD I, 0x%03X", addr);
+
+  case 0xB000:
+    return format("JP V0, 0x%03X", addr);
+
+  case 0xC000:
+    return format("RND V%X, 0x%02X", x, nn);
+
+  case 0xD000:
+    return format("DRW V%X, V%X, %u", x, y, n);
+
+  case 0xE000:
+    switch (nn)
+    {
+    case 0x9E:
+      return format("SKP V%X", x);
+    case 0xA1:
+      return format("SKNP V%X", x);
+    }
+    break;
+
+  case 0xF000:
+    switch (nn)
+    {
+    case 0x07:
+      return format("LD V%X, DT", x);
+    case 0x0A:
+      return format("LD V%X, K", x);
+    case 0x15:
+      return format("LD DT, V%X", x);
+    case 0x18:
+      return format("LD ST, V%X", x);
+    case 0x1E:
+      return format("ADD I, V%X", x);
+    case 0x29:
+      return format("LD F, V%X", x);
+    case 0x33:
+      return format("LD B, V%X", x);
+    case 0x55:
+      return format("LD [I], V%X", x);
+    case 0x65:
+      return format("LD V%X, [I]", x);
+    }
+    break;
+  }
+
+  return format("DW 0x%04X", unsigned(opcode));
+}
+
+} // namespace Chip8
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+#include "cpu_state.hpp"
+
+namespace Chip8
+{
+
+/**
+ * Turn an opcode into assembly using the mnemonics of the technical
+ * reference, e.g. "LD V1, 0x2A". Unknown opcodes become "DW 0x...".
+ */
+std::string disassemble(dbyte_t opcode);
+
+} // namespace Chip8
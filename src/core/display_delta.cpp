@@ -0,0 +1,86 @@
+#include "display_delta.hpp"
+
+namespace Chip8
+{
+
+void encode_display_delta(Framebuffer         &known,
+                          const Framebuffer   &display,
+                          std::vector<uint8_t> &out)
+{
+  for (uint32_t y = 0; y < display_height; ++y)
+  {
+    auto &old_row = known[y];
+    if (display[y] == old_row)
+    {
+      continue;
+    }
+
+    out.push_back(y);
+    const size_t run_count = out.size();
+    out.push_back(0);
+
+    bool     changed = false;
+    uint32_t length  = 0;
+    for (uint32_t x = 0; x < display_width; ++x)
+    {
+      if ((display[y][x] != old_row[x]) != changed)
+      {
+        out.push_back(length);
+        ++out[run_count];
+        changed = !changed;
+        length  = 0;
+      }
+      ++length;
+    }
+    if (changed)
+    {
+      out.push_back(length);
+      ++out[run_count];
+    }
+
+    old_row = display[y];
+  }
+}
+
+bool decode_display_delta(const uint8_t *data,
+                          size_t         size,
+                          Framebuffer   &display)
+{
+  const uint8_t *const end = data + size;
+
+  while (data != end)
+  {
+    if (end - data < 2 || data[0] >= display_height ||
+        end - data - 2 < data[1])
+    {
+      return false;
+    }
+
+    auto          &row       = display[data[0]];
+    const uint32_t run_count = data[1];
+    data += 2;
+
+    uint32_t x = 0;
+    for (uint32_t run = 0; run < run_count; ++run)
+    {
+      const uint32_t length = *data++;
+      if (x + length > display_width)
+      {
+        return false;
+      }
+
+      // Odd runs are the changed pixels
+      if (run % 2 == 1)
+      {
+        for (uint32_t i = x; i < x + length; ++i)
+        {
+          row[i] ^= 1;
+        }
+      }
+      x += length;
+    }
+  }
+  return true;
+}
+
+} // namespace Chip8
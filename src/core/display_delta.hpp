@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "framebuffer.hpp"
+
+namespace Chip8
+{
+
+/**
+ * Append the rows of display that differ from known and update known to
+ * display.
+ *
+ * Each row is encoded as the row index, the number of runs and then the
+ * length of the runs of the XOR between the known and the new row,
+ * alternating between unchanged and changed pixels and starting with
+ * unchanged ones. A trailing run of unchanged pixels is left out.
+ */
+void encode_display_delta(Framebuffer         &known,
+                          const Framebuffer   &display,
+                          std::vector<uint8_t> &out);
+
+/**
+ * Apply rows written by encode_display_delta() to a display.
+ *
+ * @return false if the rows are malformed, the display may then be changed
+ *         partially
+ */
+bool decode_display_delta(const uint8_t *data,
+                          size_t         size,
+                          Framebuffer   &display);
+
+} // namespace Chip8
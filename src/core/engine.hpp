@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Chip8
+{
+
+class Cpu;
+
+/**
+ * @brief A way of executing instructions on a cpu.
+ *
+ * By default the cpu interprets one instruction per cycle. An engine can
+ * replace that for batches of cycles, e.g. by running recompiled code. It
+ * must leave the cpu in exactly the state the interpreter would.
+ */
+class Engine
+{
+public:
+  virtual ~Engine() = default;
+
+  /**
+   * Run a number of cpu cycles.
+   */
+  virtual void run(Cpu &cpu, uint32_t cycles) = 0;
+
+  /**
+   * Called after the memory of the cpu got replaced as a whole, e.g. by
+   * Cpu::set_state(). Anything cached about the code has to be dropped.
+   */
+  virtual void flush(const Cpu & /*cpu*/) {}
+
+  /**
+   * Called after the bytes [address, address + size) of memory got
+   * replaced, e.g. by Cpu::set_state() restoring a snapshot. By default the
+   * same as flush().
+   */
+  virtual void invalidate(const Cpu &cpu, uint32_t /*address*/,
+                          uint32_t /*size*/)
+  {
+    flush(cpu);
+  }
+
+  /**
+   * Cycles the engine runs as one unit from the current program counter,
+   * e.g. a recompiled block, when run() gets at least that many. 1 where
+   * it interprets. States can only be compared between units.
+   */
+  virtual uint32_t get_block_length(const Cpu & /*cpu*/) { return 1; }
+};
+
+/**
+ * Number of bytes an instruction writes to memory starting at I. Engines
+ * that cache code use this to notice self modifying programs.
+ */
+inline uint32_t get_store_size(unsigned short opcode)
+{
+  if ((opcode & 0xF0FF) == 0xF033)
+  {
+    return 3;
+  }
+  if ((opcode & 0xF0FF) == 0xF055)
+  {
+    return ((opcode & 0x0F00) >> 8) + 1;
+  }
+  return 0;
+}
+
+} // namespace Chip8
@@ -0,0 +1,422 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "explorer.hpp"
+#include "headless_keyboard.hpp"
+#include "interpreter.hpp"
+#include "state_hash.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+uint64_t next_power_of_two(uint64_t value)
+{
+  uint64_t result = 1;
+  while (result < value)
+  {
+    result <<= 1;
+  }
+  return result;
+}
+
+/**
+ * Hash of everything in a state, including the random engine, which
+ * hash_state() leaves out.
+ */
+uint64_t get_key(const CpuState &state)
+{
+  const StateHash hash = hash_state(state);
+
+  uint64_t random = 0xcbf29ce484222325;
+  const auto engine =
+      reinterpret_cast<const byte_t *>(&state.random_engine);
+  for (size_t i = 0; i < sizeof(state.random_engine); ++i)
+  {
+    random = (random ^ engine[i]) * 0x100000001b3;
+  }
+
+  return hash.registers ^ (hash.memory * 0x9E3779B97F4A7C15ull) ^
+         (hash.framebuffer * 0xC2B2AE3D27D4EB4Full) ^
+         (random * 0x165667B19E3779F9ull);
+}
+
+void write_length(std::vector<byte_t> &out, size_t length)
+{
+  while (length >= 0x80)
+  {
+    out.push_back(byte_t(length | 0x80));
+    length >>= 7;
+  }
+  out.push_back(byte_t(length));
+}
+
+size_t read_length(const byte_t *&in)
+{
+  size_t length = 0;
+  for (uint32_t shift = 0;; shift += 7)
+  {
+    const byte_t value = *in++;
+    length |= size_t(value & 0x7F) << shift;
+    if (!(value & 0x80))
+    {
+      return length;
+    }
+  }
+}
+
+/**
+ * Store a state as runs of bytes equal to the base and runs of bytes that
+ * differ. States found by a search differ from the start state in the
+ * registers, the framebuffer and a few bytes of memory.
+ */
+void compress(const CpuState      &state,
+              const CpuState      &base,
+              std::vector<byte_t> &out)
+{
+  const auto   bytes      = reinterpret_cast<const byte_t *>(&state);
+  const auto   base_bytes = reinterpret_cast<const byte_t *>(&base);
+  const size_t size       = sizeof(CpuState);
+
+  out.clear();
+  for (size_t i = 0; i < size;)
+  {
+    size_t equal = i;
+    while (equal + 8 <= size &&
+           std::memcmp(bytes + equal, base_bytes + equal, 8) == 0)
+    {
+      equal += 8;
+    }
+    while (equal < size && bytes[equal] == base_bytes[equal])
+    {
+      ++equal;
+    }
+
+    size_t changed = equal;
+    while (changed < size && bytes[changed] != base_bytes[changed])
+    {
+      ++changed;
+    }
+
+    write_length(out, equal - i);
+    write_length(out, changed - equal);
+    out.insert(out.end(), bytes + equal, bytes + changed);
+    i = changed;
+  }
+}
+
+void decompress(const std::vector<byte_t> &in,
+                const CpuState            &base,
+                CpuState                  &state)
+{
+  state = base;
+
+  const auto    bytes    = reinterpret_cast<byte_t *>(&state);
+  const byte_t *position = in.data();
+  const byte_t *end      = in.data() + in.size();
+
+  for (size_t i = 0; position < end;)
+  {
+    i += read_length(position);
+
+    const size_t changed = read_length(position);
+    std::memcpy(bytes + i, position, changed);
+    position += changed;
+    i += changed;
+  }
+}
+
+} // namespace
+
+ConcurrentHashSet::ConcurrentHashSet(uint64_t capacity)
+    : capacity(capacity),
+      mask(next_power_of_two(std::max<uint64_t>(capacity, 1) * 2) - 1),
+      slots(std::make_unique<std::atomic<uint64_t>[]>(mask + 1))
+{
+  for (uint64_t i = 0; i <= mask; ++i)
+  {
+    slots[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+ConcurrentHashSet::Insert ConcurrentHashSet::insert(uint64_t hash,
+                                                    uint32_t depth)
+{
+  const uint64_t key   = std::max<uint64_t>(hash >> 5, 1) << 5;
+  const uint64_t entry = key | (depth & 0x1F);
+
+  for (uint64_t slot = (hash >> 5) & mask;; slot = (slot + 1) & mask)
+  {
+    uint64_t current = slots[slot].load(std::memory_order_relaxed);
+
+    while ((current & ~uint64_t(0x1F)) == key)
+    {
+      if ((current & 0x1F) <= depth)
+      {
+        return Insert::Present;
+      }
+      if (slots[slot].compare_exchange_weak(current, entry,
+                                            std::memory_order_relaxed))
+      {
+        return Insert::Shallower;
+      }
+    }
+    if (current != 0)
+    {
+      continue;
+    }
+
+    // Claim the slot only while there is room, the count may overshoot by
+    // a few threads
+    if (count.load(std::memory_order_relaxed) >= capacity)
+    {
+      return Insert::Full;
+    }
+    if (slots[slot].compare_exchange_strong(current, entry,
+                                            std::memory_order_relaxed))
+    {
+      count.fetch_add(1, std::memory_order_relaxed);
+      return Insert::Added;
+    }
+
+    // Lost the slot to another thread, look at it again
+    slot = (slot - 1) & mask;
+  }
+}
+
+Explorer::Explorer(const ExplorerOptions &options)
+    : options(options),
+      thread_count(options.thread_count > 0
+                       ? options.thread_count
+                       : std::max(1u, std::thread::hardware_concurrency())),
+      queues(std::make_unique<Queue[]>(thread_count))
+{
+  if (options.depth > max_explore_depth)
+  {
+    throw std::runtime_error("Search depth of " +
+                             std::to_string(options.depth) + " is to large");
+  }
+}
+
+Explorer::~Explorer() = default;
+
+ExplorerStatistics Explorer::run(const CpuState &start_state,
+                                 const Visitor  &search_visitor)
+{
+  start   = &start_state;
+  visitor = &search_visitor;
+  seen    = std::make_unique<ConcurrentHashSet>(options.max_states);
+
+  pending             = 0;
+  frontier_bytes      = 0;
+  peak_frontier_bytes = 0;
+  stopping            = false;
+  truncated           = false;
+
+  const auto begin = std::chrono::steady_clock::now();
+
+  std::vector<ExplorerStatistics> statistics(thread_count);
+
+  seen->insert(get_key(start_state), 0);
+  const Visit visit =
+      search_visitor ? search_visitor(start_state, {}) : Visit::Expand;
+  if (visit == Visit::Expand && options.depth > 0 && !start_state.paused)
+  {
+    Node root;
+    compress(start_state, start_state, root.state);
+    push(0, std::move(root));
+  }
+
+  std::vector<std::thread> workers;
+  for (uint32_t thread = 1; thread < thread_count; ++thread)
+  {
+    workers.emplace_back(&Explorer::work, this, thread,
+                         std::ref(statistics[thread]));
+  }
+  work(0, statistics[0]);
+  for (auto &worker : workers)
+  {
+    worker.join();
+  }
+
+  // Left over after a stop
+  for (uint32_t thread = 0; thread < thread_count; ++thread)
+  {
+    queues[thread].nodes.clear();
+  }
+
+  const auto finish = std::chrono::steady_clock::now();
+
+  ExplorerStatistics result;
+  for (const auto &part : statistics)
+  {
+    result.states += part.states;
+    result.duplicates += part.duplicates;
+    result.revisits += part.revisits;
+    result.steals += part.steals;
+    result.stored_states += part.stored_states;
+    result.stored_bytes += part.stored_bytes;
+  }
+  result.unique              = seen->size();
+  result.peak_frontier_bytes = peak_frontier_bytes;
+  result.hash_set_bytes      = seen->get_memory_usage();
+  result.truncated           = truncated;
+  result.seconds = std::chrono::duration<double>(finish - begin).count();
+  return result;
+}
+
+void Explorer::work(uint32_t thread, ExplorerStatistics &statistics)
+{
+  Node node;
+
+  while (!stopping.load(std::memory_order_relaxed))
+  {
+    bool found = pop(thread, node);
+    if (!found && steal(thread, node))
+    {
+      found = true;
+      ++statistics.steals;
+    }
+
+    if (found)
+    {
+      expand(thread, node, statistics);
+      pending.fetch_sub(1, std::memory_order_acq_rel);
+      continue;
+    }
+
+    // Nothing queued and nothing being expanded that could queue more
+    if (pending.load(std::memory_order_acquire) == 0)
+    {
+      return;
+    }
+    std::this_thread::yield();
+  }
+}
+
+void Explorer::expand(uint32_t            thread,
+                      const Node         &node,
+                      ExplorerStatistics &statistics)
+{
+  CpuState parent;
+  decompress(node.state, *start, parent);
+
+  const uint32_t cycles = options.frames * options.cycles_per_frame;
+
+  HeadlessKeyboard keyboard;
+  CpuState         state;
+  for (uint32_t key = 0; key < 16 && !stopping; ++key)
+  {
+    state = parent;
+    keyboard.set_keys(1 << key);
+    for (uint32_t i = 0; i < cycles && !state.paused; ++i)
+    {
+      cycle(state, keyboard);
+    }
+    ++statistics.states;
+
+    const InputPath path = node.path.then(key);
+
+    switch (seen->insert(get_key(state), path.length))
+    {
+    case ConcurrentHashSet::Insert::Added:
+      break;
+
+    case ConcurrentHashSet::Insert::Shallower:
+      ++statistics.revisits;
+      break;
+
+    case ConcurrentHashSet::Insert::Present:
+      ++statistics.duplicates;
+      continue;
+
+    case ConcurrentHashSet::Insert::Full:
+      truncated = true;
+      continue;
+    }
+
+    const Visit visit = *visitor ? (*visitor)(state, path) : Visit::Expand;
+    if (visit == Visit::Stop)
+    {
+      stopping = true;
+      return;
+    }
+
+    // A state waiting for a key stays as it is, whatever is pressed
+    if (visit == Visit::Expand && path.length < options.depth && !state.paused)
+    {
+      Node child;
+      child.path = path;
+      compress(state, *start, child.state);
+
+      ++statistics.stored_states;
+      statistics.stored_bytes += child.state.size();
+      push(thread, std::move(child));
+    }
+  }
+}
+
+void Explorer::push(uint32_t thread, Node node)
+{
+  const size_t bytes = node.state.size();
+  pending.fetch_add(1, std::memory_order_relaxed);
+
+  {
+    std::lock_guard<std::mutex> lock(queues[thread].mutex);
+    queues[thread].nodes.push_back(std::move(node));
+  }
+
+  const size_t current =
+      frontier_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  size_t peak = peak_frontier_bytes.load(std::memory_order_relaxed);
+  while (current > peak &&
+         !peak_frontier_bytes.compare_exchange_weak(
+             peak, current, std::memory_order_relaxed))
+  {
+  }
+}
+
+bool Explorer::pop(uint32_t thread, Node &node)
+{
+  std::lock_guard<std::mutex> lock(queues[thread].mutex);
+
+  auto &nodes = queues[thread].nodes;
+  if (nodes.empty())
+  {
+    return false;
+  }
+
+  // Deepest first keeps the frontier small
+  node = std::move(nodes.back());
+  nodes.pop_back();
+  frontier_bytes.fetch_sub(node.state.size(), std::memory_order_relaxed);
+  return true;
+}
+
+bool Explorer::steal(uint32_t thread, Node &node)
+{
+  for (uint32_t offset = 1; offset < thread_count; ++offset)
+  {
+    Queue &victim = queues[(thread + offset) % thread_count];
+
+    std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+    if (!lock.owns_lock() || victim.nodes.empty())
+    {
+      continue;
+    }
+
+    // The shallowest state has the most work below it
+    node = std::move(victim.nodes.front());
+    victim.nodes.pop_front();
+    frontier_bytes.fetch_sub(node.state.size(), std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+} // namespace Chip8
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "cpu_state.hpp"
+
+namespace Chip8
+{
+
+/**
+ * Steps an input path can have at most, a key takes 4 bits of 64.
+ */
+constexpr uint32_t max_explore_depth = 16;
+
+/**
+ * @brief Keys held down since the start state, one per step.
+ */
+struct InputPath
+{
+  /**
+   * Key of step n in bits 4n to 4n + 3.
+   */
+  uint64_t keys   = 0;
+  uint32_t length = 0;
+
+  uint32_t get_key(uint32_t step) const { return keys >> (4 * step) & 0xF; }
+
+  InputPath then(uint32_t key) const
+  {
+    InputPath path = *this;
+    path.keys |= uint64_t(key) << (4 * length);
+    ++path.length;
+    return path;
+  }
+};
+
+/**
+ * @brief Set of state hashes that threads insert into without locks, with
+ * the smallest depth each state was found at.
+ *
+ * Open addressing with a fixed number of slots, so that the memory it
+ * takes is known up front. A slot holds the upper 59 bits of the hash and
+ * the depth in the lower 5 bits, 0 marks a free slot.
+ */
+class ConcurrentHashSet
+{
+public:
+  enum class Insert
+  {
+    Added,
+
+    /**
+     * Present before, but at a larger depth, which got replaced.
+     */
+    Shallower,
+
+    Present,
+    Full
+  };
+
+  /**
+   * @param capacity Hashes the set holds at most. Slots are kept at most
+   *                 half full.
+   */
+  explicit ConcurrentHashSet(uint64_t capacity);
+
+  Insert insert(uint64_t hash, uint32_t depth);
+
+  uint64_t size() const { return count.load(std::memory_order_relaxed); }
+
+  size_t get_memory_usage() const { return (mask + 1) * sizeof(uint64_t); }
+
+private:
+  const uint64_t capacity;
+  const uint64_t mask;
+
+  std::unique_ptr<std::atomic<uint64_t>[]> slots;
+  std::atomic<uint64_t>                    count{0};
+};
+
+struct ExplorerOptions
+{
+  /**
+   * Frames a key is held down for in each step.
+   */
+  uint32_t frames = 10;
+
+  uint32_t cycles_per_frame = 1;
+
+  /**
+   * Steps from the start state, at most max_explore_depth.
+   */
+  uint32_t depth = 4;
+
+  /**
+   * Distinct states to keep track of. Bounds the memory of the hash set,
+   * which is 16 to 32 bytes per state. States past the limit are dropped.
+   */
+  uint64_t max_states = 1 << 20;
+
+  /**
+   * Threads to search with, 0 for one per core.
+   */
+  uint32_t thread_count = 0;
+};
+
+struct ExplorerStatistics
+{
+  /**
+   * States computed, i.e. expanded states times 16 keys.
+   */
+  uint64_t states = 0;
+
+  /**
+   * States that were seen before, also by another path.
+   */
+  uint64_t duplicates = 0;
+
+  /**
+   * States seen before that got expanded again, since this path reached
+   * them in fewer steps.
+   */
+  uint64_t revisits = 0;
+
+  /**
+   * Distinct states, including the start state.
+   */
+  uint64_t unique = 0;
+
+  /**
+   * Frontier states taken from the queue of another thread.
+   */
+  uint64_t steals = 0;
+
+  /**
+   * Bytes of compressed states in the frontier, at most and in total over
+   * all stored states.
+   */
+  size_t   peak_frontier_bytes = 0;
+  uint64_t stored_states       = 0;
+  uint64_t stored_bytes        = 0;
+
+  size_t hash_set_bytes = 0;
+
+  /**
+   * The hash set reached max_states before the search was done.
+   */
+  bool truncated = false;
+
+  double seconds = 0.0;
+
+  double get_states_per_second() const
+  {
+    return seconds > 0.0 ? states / seconds : 0.0;
+  }
+
+  /**
+   * Share of the computed states that were duplicates.
+   */
+  double get_deduplication_ratio() const
+  {
+    return states > 0 ? double(duplicates) / states : 0.0;
+  }
+
+  /**
+   * Size of an uncompressed state per compressed byte.
+   */
+  double get_compression_ratio() const
+  {
+    return stored_bytes > 0
+               ? double(stored_states) * sizeof(CpuState) / stored_bytes
+               : 0.0;
+  }
+};
+
+/**
+ * @brief Searches the states a program reaches from a snapshot under all
+ * inputs, e.g. for testing games or looking for input sequences.
+ *
+ * Every state gets expanded with each of the 16 keys held down for a
+ * number of frames. States seen before, by hash, are dropped. The frontier
+ * is spread over a pool of threads that take work from each other when
+ * they run out. Threads work depth first on their own queue and steal the
+ * shallowest states, so the frontier stays small. Its states are kept
+ * compressed as difference to the start state.
+ *
+ * Working depth first, a state may be found through a long path before a
+ * short one. It gets expanded again then, so that every state within the
+ * depth is found, whatever order the threads run in.
+ */
+class Explorer
+{
+public:
+  enum class Visit
+  {
+    /**
+     * Expand the state further, if the depth allows it.
+     */
+    Expand,
+
+    /**
+     * Keep the state out of the frontier.
+     */
+    Skip,
+
+    /**
+     * End the search.
+     */
+    Stop
+  };
+
+  /**
+   * Called for every distinct state, from any of the threads. Again if a
+   * shorter path to it turns up.
+   */
+  using Visitor =
+      std::function<Visit(const CpuState &state, const InputPath &path)>;
+
+  /**
+   * Throws a exception if the depth is to large.
+   */
+  explicit Explorer(const ExplorerOptions &options);
+
+  ~Explorer();
+
+  Explorer(const Explorer &) = delete;
+  Explorer &operator=(const Explorer &) = delete;
+
+  /**
+   * Search from a state. The visitor also sees the start state.
+   */
+  ExplorerStatistics run(const CpuState &start, const Visitor &visitor = {});
+
+private:
+  struct Node
+  {
+    std::vector<byte_t> state{};
+    InputPath           path{};
+  };
+
+  /**
+   * Frontier of a thread. The owner works on the back, thieves take from
+   * the front.
+   */
+  struct alignas(64) Queue
+  {
+    std::mutex       mutex{};
+    std::deque<Node> nodes{};
+  };
+
+  const ExplorerOptions options;
+  const uint32_t        thread_count;
+
+  std::unique_ptr<Queue[]> queues;
+
+  const CpuState *start{};
+  const Visitor  *visitor{};
+
+  std::unique_ptr<ConcurrentHashSet> seen{};
+
+  /**
+   * Nodes queued or being expanded. The search is done at 0.
+   */
+  std::atomic<uint64_t> pending{0};
+  std::atomic<size_t>   frontier_bytes{0};
+  std::atomic<size_t>   peak_frontier_bytes{0};
+  std::atomic<bool>     stopping{false};
+  std::atomic<bool>     truncated{false};
+
+  void work(uint32_t thread, ExplorerStatistics &statistics);
+
+  void expand(uint32_t            thread,
+              const Node         &node,
+              ExplorerStatistics &statistics);
+
+  void push(uint32_t thread, Node node);
+
+  bool pop(uint32_t thread, Node &node);
+
+  bool steal(uint32_t thread, Node &node);
+};
+
+} // namespace Chip8
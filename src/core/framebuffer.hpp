@@ -0,0 +1,19 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace Chip8
+{
+
+constexpr uint32_t display_width  = 64;
+constexpr uint32_t display_height = 32;
+
+/**
+ * Contents of the monochrome display. One byte per pixel, stored row by row
+ * so that a row is contiguous in memory.
+ */
+using Framebuffer =
+    std::array<std::array<unsigned char, display_width>, display_height>;
+
+} // namespace Chip8
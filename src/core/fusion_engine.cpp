@@ -0,0 +1,299 @@
+#include <algorithm>
+
+#include "cpu.hpp"
+#include "fusion_engine.hpp"
+#include "interpreter.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+dbyte_t get_group(dbyte_t opcode) { return opcode & 0xF000; }
+
+byte_t get_x(dbyte_t opcode) { return (opcode & 0x0F00) >> 8; }
+
+byte_t get_nn(dbyte_t opcode) { return opcode & 0xFF; }
+
+/**
+ * Last address a sequence gets decoded at, they span up to three
+ * instructions.
+ */
+constexpr uint32_t decode_limit = memory_size - 6;
+
+/**
+ * Read the instruction at an address, which wraps at 4096 like every
+ * fetch of the interpreter.
+ */
+dbyte_t read_opcode(const CpuState &state, uint32_t address)
+{
+  address = mask_address(address);
+  return state.memory[address] << 8 | state.memory[address + 1];
+}
+
+bool is_skip_immediate(dbyte_t opcode)
+{
+  return get_group(opcode) == 0x3000 || get_group(opcode) == 0x4000;
+}
+
+/**
+ * Condition of a 3XNN or 4XNN instruction.
+ */
+bool is_skipping(const CpuState &state, dbyte_t opcode)
+{
+  const bool equal = state.v_registers[get_x(opcode)] == get_nn(opcode);
+  return get_group(opcode) == 0x3000 ? equal : !equal;
+}
+
+/**
+ * Same as running update_timers() cycles times.
+ */
+void update_timers(CpuState &state, uint32_t cycles)
+{
+  state.timer_delay_register =
+      state.timer_delay_register > cycles ? state.timer_delay_register - cycles
+                                          : 0;
+  state.sound_delay_register =
+      state.sound_delay_register > cycles ? state.sound_delay_register - cycles
+                                          : 0;
+}
+
+} // namespace
+
+uint64_t FusionEngine::Statistics::get_fused_cycles() const
+{
+  uint64_t sum = 0;
+  for (const auto count : fused_cycles)
+  {
+    sum += count;
+  }
+  return sum;
+}
+
+void FusionEngine::run(Cpu &cpu, uint32_t cycles)
+{
+  CpuState &state = cpu.state;
+
+  while (cycles > 0 && !state.paused)
+  {
+    // The program counter may point past 4096, e.g. after BNNN, and wraps
+    // around like in the interpreter
+    const uint32_t address = mask_address(state.pc_register);
+
+    if (address <= decode_limit)
+    {
+      const Kind kind = decode(state, address);
+      if (kind != Kind::None && get_length(kind) <= cycles)
+      {
+        const uint32_t length = execute(cpu, state, kind);
+        const auto     index  = static_cast<size_t>(kind);
+
+        cycles                         -= length;
+        statistics.cycles              += length;
+        statistics.fused_cycles[index] += length;
+        continue;
+      }
+    }
+
+    // Same as Cpu::cycle(), but the opcode is fetched already
+    const dbyte_t opcode = fetch_opcode(state);
+    cpu.execute_instruction(opcode);
+    state.pc_register += 2;
+    update_timers(state, 1);
+
+    --cycles;
+    ++statistics.cycles;
+
+    invalidate(state.i_register, get_store_size(opcode));
+  }
+}
+
+void FusionEngine::flush(const Cpu & /*cpu*/) { kinds.fill(Kind::Unknown); }
+
+void FusionEngine::invalidate(const Cpu & /*cpu*/,
+                              uint32_t address,
+                              uint32_t size)
+{
+  invalidate(address, size);
+}
+
+uint32_t FusionEngine::get_block_length(const Cpu &cpu)
+{
+  const CpuState &state   = cpu.get_state();
+  const uint32_t  address = mask_address(state.pc_register);
+  if (state.paused || address > decode_limit)
+  {
+    return 1;
+  }
+
+  const Kind kind = decode(state, address);
+  return kind == Kind::None ? 1 : get_length(kind);
+}
+
+const char *FusionEngine::get_kind_name(Kind kind)
+{
+  switch (kind)
+  {
+  case Kind::LoadLoad:
+    return "6XNN 6YNN";
+  case Kind::LoadLoadDraw:
+    return "6XNN 6YNN DXYN";
+  case Kind::IndexDraw:
+    return "ANNN DXYN";
+  case Kind::SkipJump:
+    return "3XNN|4XNN 1NNN";
+  case Kind::AddSkip:
+    return "7XNN 3YNN|4YNN";
+  case Kind::IndexAddLoad:
+    return "FX1E FY65";
+  default:
+    return "none";
+  }
+}
+
+FusionEngine::Kind FusionEngine::decode(const CpuState &state,
+                                        uint32_t        address)
+{
+  Kind &kind = kinds[address];
+  if (kind != Kind::Unknown)
+  {
+    return kind;
+  }
+
+  const dbyte_t first  = read_opcode(state, address);
+  const dbyte_t second = read_opcode(state, address + 2);
+  const dbyte_t third  = read_opcode(state, address + 4);
+
+  kind = Kind::None;
+
+  if (get_group(first) == 0x6000 && get_group(second) == 0x6000)
+  {
+    kind = get_group(third) == 0xD000 ? Kind::LoadLoadDraw : Kind::LoadLoad;
+  }
+  else if (get_group(first) == 0xA000 && get_group(second) == 0xD000)
+  {
+    kind = Kind::IndexDraw;
+  }
+  else if (is_skip_immediate(first) && get_group(second) == 0x1000)
+  {
+    kind = Kind::SkipJump;
+  }
+  else if (get_group(first) == 0x7000 && is_skip_immediate(second))
+  {
+    kind = Kind::AddSkip;
+  }
+  else if ((first & 0xF0FF) == 0xF01E && (second & 0xF0FF) == 0xF065)
+  {
+    kind = Kind::IndexAddLoad;
+  }
+
+  return kind;
+}
+
+uint32_t FusionEngine::execute(Cpu &cpu, CpuState &state, Kind kind)
+{
+  // The cached kinds get invalidated on writes, so the opcodes in memory
+  // are still the ones that were decoded. The program counter keeps the
+  // bits above 12, as the interpreter only masks it when fetching.
+  const dbyte_t  pc      = state.pc_register;
+  const uint32_t address = mask_address(pc);
+
+  const std::array<dbyte_t, 3> opcode = {read_opcode(state, address),
+                                         read_opcode(state, address + 2),
+                                         read_opcode(state, address + 4)};
+
+  uint32_t length = get_length(kind);
+
+  // The program counter is kept where the interpreter would have it when
+  // an instruction runs through execute_instruction()
+  switch (kind)
+  {
+  case Kind::LoadLoad:
+    state.v_registers[get_x(opcode[0])] = get_nn(opcode[0]);
+    state.v_registers[get_x(opcode[1])] = get_nn(opcode[1]);
+    state.pc_register                   = pc + 4;
+    break;
+
+  case Kind::LoadLoadDraw:
+    state.v_registers[get_x(opcode[0])] = get_nn(opcode[0]);
+    state.v_registers[get_x(opcode[1])] = get_nn(opcode[1]);
+    state.pc_register                   = pc + 4;
+    cpu.execute_instruction(opcode[2]);
+    state.pc_register = pc + 6;
+    break;
+
+  case Kind::IndexDraw:
+    state.i_register  = opcode[0] & 0xFFF;
+    state.pc_register = pc + 2;
+    cpu.execute_instruction(opcode[1]);
+    state.pc_register = pc + 4;
+    break;
+
+  case Kind::SkipJump:
+    if (is_skipping(state, opcode[0]))
+    {
+      // The jump gets skipped, so only one instruction runs
+      state.pc_register = pc + 4;
+      length            = 1;
+    }
+    else
+    {
+      state.pc_register = (opcode[1] & 0xFFF) + 2;
+    }
+    break;
+
+  case Kind::AddSkip:
+    state.v_registers[get_x(opcode[0])] += get_nn(opcode[0]);
+
+    state.pc_register = is_skipping(state, opcode[1]) ? pc + 6 : pc + 4;
+    break;
+
+  case Kind::IndexAddLoad:
+    state.i_register += state.v_registers[get_x(opcode[0])];
+
+    state.pc_register = pc + 2;
+    cpu.execute_instruction(opcode[1]);
+    state.pc_register = pc + 4;
+    break;
+
+  default:
+    break;
+  }
+
+  update_timers(state, length);
+
+  return length;
+}
+
+uint32_t FusionEngine::get_length(Kind kind)
+{
+  return kind == Kind::LoadLoadDraw ? 3 : 2;
+}
+
+void FusionEngine::invalidate(uint32_t address, uint32_t size)
+{
+  if (size == 0)
+  {
+    return;
+  }
+
+  // Stores wrap around at the end of memory
+  address = mask_address(address);
+  if (address + size > memory_size)
+  {
+    invalidate(0, address + size - memory_size);
+    size = memory_size - address;
+  }
+
+  // Cached sequences starting up to 5 bytes before the write cover it
+  const uint32_t begin = address >= 5 ? address - 5 : 0;
+  const uint32_t end   = std::min<uint32_t>(address + size, kinds.size());
+
+  for (uint32_t i = begin; i < end; ++i)
+  {
+    kinds[i] = Kind::Unknown;
+  }
+}
+
+} // namespace Chip8
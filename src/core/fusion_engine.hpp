@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "cpu_state.hpp"
+#include "engine.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief Interpreter that executes common instruction sequences as one.
+ *
+ * Instructions get decoded once and cached per address. Sequences that
+ * occur often in programs are recognized while decoding and later run by
+ * a single fused handler, which skips fetching, decoding and dispatching
+ * the instructions one by one. Everything else is interpreted as usual.
+ * The resulting state is exactly the one of the interpreter.
+ */
+class FusionEngine : public Engine
+{
+public:
+  enum class Kind : byte_t
+  {
+    /**
+     * Not decoded yet.
+     */
+    Unknown,
+
+    /**
+     * No sequence starts here.
+     */
+    None,
+
+    /**
+     * 6XNN 6YNN
+     */
+    LoadLoad,
+
+    /**
+     * 6XNN 6YNN DXYN
+     */
+    LoadLoadDraw,
+
+    /**
+     * ANNN DXYN
+     */
+    IndexDraw,
+
+    /**
+     * 3XNN|4XNN 1NNN
+     */
+    SkipJump,
+
+    /**
+     * 7XNN 3YNN|4YNN
+     */
+    AddSkip,
+
+    /**
+     * FX1E FY65
+     */
+    IndexAddLoad,
+
+    Count
+  };
+
+  struct Statistics
+  {
+    uint64_t cycles = 0;
+
+    /**
+     * Cycles run by fused handlers, per kind of sequence.
+     */
+    std::array<uint64_t, static_cast<size_t>(Kind::Count)> fused_cycles{};
+
+    uint64_t get_fused_cycles() const;
+  };
+
+  void run(Cpu &cpu, uint32_t cycles) override;
+
+  void flush(const Cpu &cpu) override;
+
+  void invalidate(const Cpu &cpu, uint32_t address, uint32_t size) override;
+
+  uint32_t get_block_length(const Cpu &cpu) override;
+
+  const Statistics &get_statistics() const { return statistics; }
+
+  static const char *get_kind_name(Kind kind);
+
+private:
+  /**
+   * Kind of sequence starting at each address. Kept small, so that it
+   * stays in the cache.
+   */
+  std::array<Kind, 4096> kinds{};
+
+  Statistics statistics{};
+
+  /**
+   * @param address Masked address, at most 6 bytes before the end of memory
+   */
+  Kind decode(const CpuState &state, uint32_t address);
+
+  /**
+   * Run a fused sequence.
+   *
+   * @return Number of cycles it took
+   */
+  uint32_t execute(Cpu &cpu, CpuState &state, Kind kind);
+
+  /**
+   * Maximum number of cycles a sequence takes.
+   */
+  static uint32_t get_length(Kind kind);
+
+  void invalidate(uint32_t address, uint32_t size);
+};
+
+} // namespace Chip8
@@ -0,0 +1,11 @@
+#include "headless_keyboard.hpp"
+
+namespace Chip8
+{
+
+bool HeadlessKeyboard::is_key_pressed(const unsigned char value)
+{
+  return value < 16 && (keys >> value) & 1;
+}
+
+} // namespace Chip8
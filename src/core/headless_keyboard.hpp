@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+#include "keyboard.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief Keyboard whose keys are set by the host program, e.g. from a key
+ * script or by a frontend.
+ */
+class HeadlessKeyboard : public Keyboard
+{
+public:
+  bool is_key_pressed(const unsigned char value) override;
+
+  /**
+   * Set all keys at once. Bit n is key n.
+   */
+  void set_keys(uint16_t new_keys) { keys = new_keys; }
+
+  uint16_t get_keys() const { return keys; }
+
+private:
+  uint16_t keys = 0;
+};
+
+} // namespace Chip8
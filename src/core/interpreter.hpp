@@ -0,0 +1,356 @@
+#pragma once
+
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "cpu_state.hpp"
+#include "keyboard.hpp"
+
+/**
+ * The instruction set, written once for every memory model. A state type
+ * needs the registers and framebuffer of BasicCpuState and a memory that
+ * supports reads through operator[] and a write_memory() overload.
+ *
+ * Reads start at a masked address and may go up to 15 bytes past the end
+ * of memory, where they have to see the start of memory again. Writes get
+ * the unmasked address.
+ */
+
+namespace Chip8
+{
+
+/**
+ * Read the instruction at the program counter.
+ */
+template <typename State> dbyte_t fetch_opcode(const State &state)
+{
+  const uint32_t pc = mask_address(state.pc_register);
+  return state.memory[pc] << 8 | state.memory[pc + 1];
+}
+
+/**
+ * Execute a single instruction. The program counter has to point to it.
+ * Like the original interpreter, jumps set the program counter to the
+ * target and the caller increases it afterwards.
+ */
+template <typename State>
+void interpret(State &state, const dbyte_t opcode, Keyboard &keyboard)
+{
+  const dbyte_t addr = opcode & 0xFFF;
+  const byte_t  x    = (opcode & 0x0F00) >> 8;
+  const byte_t  y    = (opcode & 0x00F0) >> 4;
+
+  switch (opcode & 0xF000)
+  {
+  case 0x0000:
+    switch (opcode)
+    {
+    case 0x00E0:
+      state.framebuffer = {};
+      break;
+
+    case 0x00EE:
+      state.pc_register = state.stack[--state.sp_register & 0xF];
+      break;
+    }
+    break;
+
+  case 0x1000:
+    state.pc_register = addr;
+    break;
+
+  case 0x2000:
+    state.stack[state.sp_register++ & 0xF] = state.pc_register;
+    state.pc_register                        = addr;
+    break;
+
+  case 0x3000:
+    if (state.v_registers[x] == (opcode & 0xFF))
+    {
+      state.pc_register += 2;
+    }
+    break;
+
+  case 0x4000:
+    if (state.v_registers[x] != (opcode & 0xFF))
+    {
+      state.pc_register += 2;
+    }
+    break;
+
+  case 0x5000:
+    if (state.v_registers[x] == state.v_registers[y])
+    {
+      state.pc_register += 2;
+    }
+    break;
+
+  case 0x6000:
+    state.v_registers[x] = (opcode & 0xFF);
+    break;
+
+  case 0x7000:
+    state.v_registers[x] += (opcode & 0xFF);
+    break;
+
+  case 0x8000:
+    switch (opcode & 0xF)
+    {
+    case 0x0:
+      state.v_registers[x] = state.v_registers[y];
+      break;
+
+    case 0x1:
+      state.v_registers[x] |= state.v_registers[y];
+      break;
+
+    case 0x2:
+      state.v_registers[x] &= state.v_registers[y];
+      break;
+
+    case 0x3:
+      state.v_registers[x] ^= state.v_registers[y];
+      break;
+
+    case 0x4:
+    {
+      dbyte_t sum = state.v_registers[x] + state.v_registers[y];
+
+      state.v_registers[0xF] = 0;
+
+      if (sum > 0xFF)
+      {
+        state.v_registers[0xF] = 1;
+      }
+
+      state.v_registers[x] = sum;
+    }
+    break;
+
+    case 0x5:
+    {
+      dbyte_t sum = state.v_registers[x] - state.v_registers[y];
+
+      state.v_registers[0xF] = 0;
+
+      if (state.v_registers[y] > state.v_registers[x])
+      {
+        state.v_registers[0xF] = 1;
+      }
+
+      state.v_registers[x] = sum;
+    }
+    break;
+
+    case 0x6:
+      state.v_registers[0xF] = (state.v_registers[x] & 0x1);
+
+      state.v_registers[x] >>= 1;
+      break;
+
+    case 0x7:
+      state.v_registers[0xF] = 0;
+
+      if (state.v_registers[y] > state.v_registers[x])
+      {
+        state.v_registers[0xF] = 1;
+      }
+
+      state.v_registers[x] = state.v_registers[y] - state.v_registers[x];
+      break;
+
+    case 0xE:
+      state.v_registers[0xF] = (state.v_registers[x] & 0x80);
+      state.v_registers[x] <<= 1;
+      break;
+    }
+
+    break;
+
+  case 0x9000:
+    if (state.v_registers[x] != state.v_registers[y])
+    {
+      state.pc_register += 2;
+    }
+    break;
+
+  case 0xA000:
+    state.i_register = addr;
+    break;
+
+  case 0xB000:
+    state.pc_register = (opcode & 0xFFF) + state.v_registers[0];
+    break;
+
+  case 0xC000:
+  {
+    std::uniform_int_distribution<byte_t> uniform_dist(0, 255);
+
+    const byte_t random_num = uniform_dist(state.random_engine);
+    state.v_registers[x]    = random_num & (opcode & 0xFF);
+  }
+  break;
+
+  case 0xD000:
+  {
+    byte_t width  = 8;
+    byte_t height = opcode & 0xF;
+
+    state.v_registers[0xF] = 0;
+
+    // At most 15 rows, which the guard covers
+    const uint32_t sprite_address = mask_address(state.i_register);
+
+    for (uint32_t row = 0; row < height; ++row)
+    {
+      byte_t sprite = state.memory[sprite_address + row];
+
+      // Sprites wrap around to the opposite side of the display
+      auto &pixels =
+          state.framebuffer[(state.v_registers[y] + row) % display_height];
+
+      for (uint32_t column = 0; column < width; ++column)
+      { // If the bit (sprite) is not 0, render/erase the pixel
+        if ((sprite & 0x80) > 0)
+        {
+          auto &pixel = pixels[(state.v_registers[x] + column) % display_width];
+
+          // If a pixel gets erased, set VF to 1
+          if (pixel)
+          {
+            state.v_registers[0xF] = 1;
+          }
+
+          pixel ^= 1;
+        }
+
+        // Shift the sprite left 1. This will move the next next col/bit of the
+        // sprite into the first position. Ex. 10010000 << 1 will become 0010000
+        sprite <<= 1;
+      }
+    }
+  }
+  break;
+
+  case 0xE000:
+    switch (opcode & 0xFF)
+    {
+    case 0x9E:
+      if (keyboard.is_key_pressed(state.v_registers[x]))
+      {
+        state.pc_register += 2;
+      }
+      break;
+
+    case 0xA1:
+      if (!keyboard.is_key_pressed(state.v_registers[x]))
+      {
+        state.pc_register += 2;
+      }
+      break;
+    }
+
+    break;
+
+  case 0xF000:
+    switch (opcode & 0xFF)
+    {
+    case 0x07:
+      state.v_registers[x] = state.timer_delay_register;
+      break;
+
+    case 0x0A:
+      state.paused = true;
+
+      // TODO: Set callback to return to execution on keypress
+      break;
+
+    case 0x15:
+      state.timer_delay_register = state.v_registers[x];
+      break;
+
+    case 0x18:
+      state.sound_delay_register = state.v_registers[x];
+      break;
+
+    case 0x1E:
+      state.i_register += state.v_registers[x];
+      break;
+
+    case 0x29:
+      state.i_register = state.v_registers[x] * 5;
+      break;
+
+    case 0x33:
+      // Get the hundreds digit and place it in I.
+      write_memory(state.memory, state.i_register,
+                   state.v_registers[x] / 100);
+
+      // Get tens digit and place it in I+1. Gets a value between 0 and 99,
+      // then divides by 10 to give us a value between 0 and 9.
+      write_memory(state.memory, state.i_register + 1,
+                   (state.v_registers[x] % 100) / 10);
+
+      // Get the value of the ones (last) digit and place it in I+2.
+      write_memory(state.memory, state.i_register + 2,
+                   state.v_registers[x] % 10);
+      break;
+
+    case 0x55:
+      for (uint32_t i = 0; i <= x; ++i)
+      {
+        write_memory(state.memory, state.i_register + i,
+                     state.v_registers[i]);
+      }
+      break;
+
+    case 0x65:
+    {
+      // At most 16 bytes, which the guard covers
+      const uint32_t address = mask_address(state.i_register);
+      for (uint32_t i = 0; i <= x; ++i)
+      {
+        state.v_registers[i] = state.memory[address + i];
+      }
+    }
+    break;
+    }
+
+    break;
+
+  default:
+    throw std::runtime_error("Unknown opcode " + std::to_string(opcode));
+  }
+}
+
+template <typename State> void update_timers(State &state)
+{
+  if (state.timer_delay_register > 0)
+  {
+    --state.timer_delay_register;
+  }
+
+  if (state.sound_delay_register > 0)
+  {
+    --state.sound_delay_register;
+  }
+}
+
+/**
+ * Run one cycle, see Cpu::cycle().
+ */
+template <typename State> void cycle(State &state, Keyboard &keyboard)
+{
+  if (state.paused)
+  {
+    return;
+  }
+
+  const dbyte_t opcode = fetch_opcode(state);
+  interpret(state, opcode, keyboard);
+  state.pc_register += 2;
+  update_timers(state);
+}
+
+} // namespace Chip8
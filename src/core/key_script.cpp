@@ -0,0 +1,46 @@
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "key_script.hpp"
+
+namespace Chip8
+{
+
+std::vector<KeyEvent> load_key_script(const std::string &filepath)
+{
+  std::ifstream in(filepath);
+  if (!in)
+  {
+    throw std::runtime_error("Could not open key script " + filepath);
+  }
+
+  std::vector<KeyEvent> events;
+
+  std::string line;
+  for (uint32_t line_number = 1; std::getline(in, line); ++line_number)
+  {
+    line = line.substr(0, line.find('#'));
+    if (line.find_first_not_of(" \t\r") == std::string::npos)
+    {
+      continue;
+    }
+
+    std::istringstream fields(line);
+    KeyEvent           event;
+    uint32_t           keys;
+    if (!(fields >> event.cycle >> std::hex >> keys) || keys > 0xFFFF ||
+        (!events.empty() && event.cycle < events.back().cycle))
+    {
+      throw std::runtime_error(filepath + ":" + std::to_string(line_number) +
+                               ": Invalid key event");
+    }
+
+    event.keys = keys;
+    events.push_back(event);
+  }
+
+  return events;
+}
+
+} // namespace Chip8
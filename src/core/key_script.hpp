@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Chip8
+{
+
+/**
+ * The keys held down from a cycle on. Bit n is key n.
+ */
+struct KeyEvent
+{
+  uint64_t cycle{};
+  uint16_t keys{};
+};
+
+/**
+ * Load a key script. Every line holds a cycle and the keys held down from
+ * then on as hex mask, e.g. "600 0x0010" to press key 4 at cycle 600.
+ * Everything after a # is a comment. Events have to be sorted by cycle.
+ *
+ * Throws a exception if the file can not be read or is malformed.
+ */
+std::vector<KeyEvent> load_key_script(const std::string &filepath);
+
+} // namespace Chip8
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "disassembler.hpp"
+#include "lockstep.hpp"
+
+namespace Chip8
+{
+
+Lockstep::Lockstep(const std::vector<byte_t> &program,
+                   std::vector<KeyEvent>      key_script)
+    : key_script(std::move(key_script))
+{
+  auto keyboard      = std::make_unique<HeadlessKeyboard>();
+  reference_keyboard = keyboard.get();
+  reference          = std::make_unique<Cpu>(std::move(keyboard));
+
+  keyboard           = std::make_unique<HeadlessKeyboard>();
+  candidate_keyboard = keyboard.get();
+  candidate          = std::make_unique<Cpu>(std::move(keyboard));
+
+  reference->init();
+  reference->load_program(program);
+
+  // Also makes both draw the same random numbers
+  candidate->set_state(reference->get_state());
+}
+
+bool Lockstep::run(uint64_t cycles, uint32_t step)
+{
+  const uint64_t end = cycle + cycles;
+
+  if (step == 1)
+  {
+    reference_hash.reset(reference->get_state());
+    candidate_hash.reset(candidate->get_state());
+    next_full_check = cycle + full_check_interval;
+  }
+
+  while (cycle < end)
+  {
+    update_keys();
+
+    // Key changes have to happen at the same cycle as in a run of the
+    // interpreter alone
+    uint64_t cycles_to_run = end - cycle;
+    if (next_key_event < key_script.size())
+    {
+      cycles_to_run = std::min<uint64_t>(
+          cycles_to_run, key_script[next_key_event].cycle - cycle);
+    }
+
+    if (step == 1)
+    {
+      if (!step_engine_block(cycles_to_run))
+      {
+        return false;
+      }
+      continue;
+    }
+
+    if (!step_block(std::min<uint64_t>(step, cycles_to_run)))
+    {
+      return false;
+    }
+  }
+
+  // The incremental hashes only cover what the instructions were expected
+  // to write
+  return step != 1 || check_full();
+}
+
+void Lockstep::update_keys()
+{
+  while (next_key_event < key_script.size() &&
+         key_script[next_key_event].cycle <= cycle)
+  {
+    reference_keyboard->set_keys(key_script[next_key_event].keys);
+    candidate_keyboard->set_keys(key_script[next_key_event].keys);
+    ++next_key_event;
+  }
+}
+
+bool Lockstep::step_engine_block(uint64_t max_cycles)
+{
+  const CpuState &reference_state = reference->get_state();
+  const CpuState &candidate_state = candidate->get_state();
+
+  step_pc = reference_state.pc_register;
+
+  Engine        *engine = candidate->get_engine();
+  const uint32_t length = uint32_t(std::max<uint64_t>(
+      1, std::min<uint64_t>(engine ? engine->get_block_length(*candidate) : 1,
+                            max_cycles)));
+
+  // The reference goes instruction by instruction and collects what they
+  // write. The candidate runs the block as a whole, the same parts of its
+  // state get rehashed.
+  DirtyRegion region;
+  for (uint32_t i = 0; i < length; ++i)
+  {
+    reference_hash.begin(reference_state);
+    region.merge(reference_hash.get_region());
+    reference->run(1);
+    reference_hash.end(reference_state);
+  }
+
+  candidate_hash.begin(candidate_state, region);
+  candidate->run(length);
+  candidate_hash.end(candidate_state);
+
+  cycle += length;
+  if (length > 1)
+  {
+    block_cycles += length;
+  }
+
+  if (reference_hash.get() != candidate_hash.get())
+  {
+    make_report(step_pc);
+    return false;
+  }
+
+  if (cycle >= next_full_check)
+  {
+    next_full_check = cycle + full_check_interval;
+    return check_full();
+  }
+
+  return true;
+}
+
+bool Lockstep::check_full()
+{
+  const CpuState &reference_state = reference->get_state();
+  const CpuState &candidate_state = candidate->get_state();
+
+  if (hash_state(reference_state) != hash_state(candidate_state))
+  {
+    make_report(step_pc);
+    return false;
+  }
+
+  reference_hash.reset(reference_state);
+  candidate_hash.reset(candidate_state);
+  return true;
+}
+
+bool Lockstep::step_block(uint32_t cycles)
+{
+  step_pc = reference->get_state().pc_register;
+
+  reference->run(cycles);
+  candidate->run(cycles);
+  cycle += cycles;
+
+  if (hash_state(reference->get_state()) != hash_state(candidate->get_state()))
+  {
+    make_report(step_pc);
+    return false;
+  }
+
+  return true;
+}
+
+void Lockstep::make_report(dbyte_t pc)
+{
+  const CpuState &a = reference->get_state();
+  const CpuState &b = candidate->get_state();
+
+  std::ostringstream out;
+
+  const auto hex = [](unsigned value, int digits) {
+    std::ostringstream text;
+    text << "0x" << std::hex << std::uppercase << std::setw(digits)
+         << std::setfill('0') << value;
+    return text.str();
+  };
+
+  const auto compare = [&](const std::string &name,
+                           unsigned           reference_value,
+                           unsigned           candidate_value,
+                           int                digits) {
+    if (reference_value != candidate_value)
+    {
+      out << "  " << std::left << std::setw(10) << name << std::setw(11)
+          << hex(reference_value, digits) << hex(candidate_value, digits)
+          << "\n";
+    }
+  };
+
+  out << "States differ after cycle " << cycle;
+  {
+    const uint32_t address = mask_address(pc);
+    const dbyte_t  opcode  = a.memory[address] << 8 | a.memory[address + 1];
+    out << " in the step starting at " << hex(address, 3) << ": "
+        << hex(opcode, 4) << "  " << disassemble(opcode);
+  }
+  out << "\n            reference  candidate\n";
+
+  for (uint32_t i = 0; i < a.v_registers.size(); ++i)
+  {
+    const std::string name = "V" + hex(i, 1).substr(2);
+    compare(name, a.v_registers[i], b.v_registers[i], 2);
+  }
+  compare("I", a.i_register, b.i_register, 3);
+  compare("PC", a.pc_register, b.pc_register, 3);
+  compare("SP", a.sp_register, b.sp_register, 2);
+  compare("DT", a.timer_delay_register, b.timer_delay_register, 2);
+  compare("ST", a.sound_delay_register, b.sound_delay_register, 2);
+  compare("paused", a.paused, b.paused, 1);
+  for (uint32_t i = 0; i < a.stack.size(); ++i)
+  {
+    compare("stack[" + std::to_string(i) + "]", a.stack[i], b.stack[i], 3);
+  }
+
+  uint32_t memory_differences = 0;
+  for (uint32_t i = 0; i < memory_size; ++i)
+  {
+    if (a.memory[i] != b.memory[i] && memory_differences++ < 16)
+    {
+      compare("[" + hex(i, 3) + "]", a.memory[i], b.memory[i], 2);
+    }
+  }
+  if (memory_differences > 16)
+  {
+    out << "  ... " << memory_differences
+        << " bytes of memory differ in total\n";
+  }
+
+  uint32_t pixel_differences = 0;
+  for (uint32_t y = 0; y < display_height; ++y)
+  {
+    for (uint32_t x = 0; x < display_width; ++x)
+    {
+      pixel_differences += a.framebuffer[y][x] != b.framebuffer[y][x];
+    }
+  }
+  if (pixel_differences > 0)
+  {
+    out << "  " << pixel_differences << " pixels differ\n";
+  }
+
+  report = out.str();
+}
+
+} // namespace Chip8
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpu.hpp"
+#include "headless_keyboard.hpp"
+#include "key_script.hpp"
+#include "state_hash.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief Runs a program on a reference cpu and a candidate side by side.
+ *
+ * The reference cpu always interprets. The candidate gets the engine that
+ * is to be checked. Both see the same program, random numbers and input.
+ * After every step the hashes of both states are compared and the run
+ * stops at the first difference.
+ *
+ * A step never splits what the engine runs as one unit, see
+ * Engine::get_block_length(), so that fused sequences and recompiled
+ * blocks get checked instead of the interpreter the engine falls back to.
+ */
+class Lockstep
+{
+public:
+  Lockstep(const std::vector<byte_t> &program,
+           std::vector<KeyEvent>      key_script = {});
+
+  Cpu &get_reference() { return *reference; }
+
+  Cpu &get_candidate() { return *candidate; }
+
+  /**
+   * Run until the cycle count is reached or the states differ.
+   *
+   * With a step of 1 the states are compared after every block of the
+   * engine, which is a single instruction where it interprets, using
+   * incrementally updated hashes. Complete hashes get compared every
+   * full_check_interval cycles and at the end. Larger steps compare
+   * complete hashes after each step.
+   *
+   * @return false if the states differ
+   */
+  bool run(uint64_t cycles, uint32_t step = 1);
+
+  uint64_t get_cycle() const { return cycle; }
+
+  /**
+   * Cycles the candidate ran in blocks of more than one instruction.
+   */
+  uint64_t get_block_cycles() const { return block_cycles; }
+
+  /**
+   * Description of the difference, including a register and memory diff.
+   */
+  const std::string &get_report() const { return report; }
+
+private:
+  /**
+   * Compare the incremental hashes against full ones this often, to catch
+   * writes outside of what an instruction may write.
+   */
+  const uint64_t full_check_interval = 1 << 16;
+
+  std::unique_ptr<Cpu> reference{};
+  std::unique_ptr<Cpu> candidate{};
+
+  HeadlessKeyboard *reference_keyboard{};
+  HeadlessKeyboard *candidate_keyboard{};
+
+  std::vector<KeyEvent> key_script{};
+  size_t                next_key_event = 0;
+
+  IncrementalStateHash reference_hash{};
+  IncrementalStateHash candidate_hash{};
+
+  uint64_t    cycle           = 0;
+  uint64_t    block_cycles    = 0;
+  uint64_t    next_full_check = 0;
+  dbyte_t     step_pc         = 0;
+  std::string report{};
+
+  void update_keys();
+
+  /**
+   * Run the next block of the engine, at most the given number of cycles,
+   * and compare the incremental hashes.
+   */
+  bool step_engine_block(uint64_t max_cycles);
+
+  /**
+   * Compare complete hashes, which also catch writes outside of what the
+   * instructions were expected to write.
+   */
+  bool check_full();
+
+  bool step_block(uint32_t cycles);
+
+  /**
+   * @param pc Program counter at the start of the failed step
+   */
+  void make_report(dbyte_t pc);
+};
+
+} // namespace Chip8
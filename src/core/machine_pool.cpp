@@ -0,0 +1,70 @@
+#include <cassert>
+
+#include "cpu.hpp"
+#include "interpreter.hpp"
+#include "machine_pool.hpp"
+
+namespace Chip8
+{
+
+void Machine::run(uint32_t cycles)
+{
+  for (uint32_t i = 0; i < cycles && !state.paused; ++i)
+  {
+    cycle(state, keyboard);
+  }
+}
+
+MachinePool::MachinePool(const std::vector<byte_t> &program,
+                         uint32_t                   capacity,
+                         uint64_t                   seed)
+    : capacity(capacity),
+      next_seed(seed),
+      machines(std::make_unique<Machine[]>(capacity)),
+      in_use(capacity, false)
+{
+  // The one Cpu of the pool, for loading the sprites and the program
+  Cpu cpu(std::make_unique<HeadlessKeyboard>());
+  cpu.init();
+  cpu.load_program(program);
+  initial_state = cpu.get_state();
+
+  free_machines.reserve(capacity);
+  for (uint32_t i = capacity; i-- > 0;)
+  {
+    free_machines.push_back(i);
+  }
+}
+
+Machine *MachinePool::acquire()
+{
+  if (free_machines.empty())
+  {
+    return nullptr;
+  }
+
+  const uint32_t index = free_machines.back();
+  free_machines.pop_back();
+  in_use[index] = true;
+
+  Machine &machine = machines[index];
+
+  machine.state = initial_state;
+  machine.state.random_engine.seed(next_seed++);
+  machine.keyboard.set_keys(0);
+  return &machine;
+}
+
+void MachinePool::release(Machine *machine)
+{
+  assert(machine >= machines.get() && machine < machines.get() + capacity);
+
+  // Released twice, it would be handed out twice
+  const uint32_t index = machine - machines.get();
+  assert(in_use[index]);
+
+  in_use[index] = false;
+  free_machines.push_back(index);
+}
+
+} // namespace Chip8
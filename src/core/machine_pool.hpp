@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "cpu_state.hpp"
+#include "headless_keyboard.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief A headless machine owned by a MachinePool.
+ *
+ * Holds no resource of the operating system and nothing on the heap, so it
+ * gets reset by copying a state over it.
+ */
+struct alignas(64) Machine
+{
+  CpuState         state{};
+  HeadlessKeyboard keyboard{};
+
+  /**
+   * Run cycles on the interpreter.
+   */
+  void run(uint32_t cycles);
+};
+
+/**
+ * @brief Hands out machines that run the same program, for workloads that
+ * create many short lived machines, e.g. test runs or searches.
+ *
+ * A Cpu takes a keyboard on the heap and draws its seed from the operating
+ * system. The pool allocates all machines up front, each on its own cache
+ * lines, and builds the state after loading the program once. Acquiring a
+ * machine copies that state and sets the seed.
+ */
+class MachinePool
+{
+public:
+  /**
+   * Throws a exception if the program is to long.
+   *
+   * @param program  Program all machines run
+   * @param capacity Number of machines
+   * @param seed     Machine number n handed out draws random numbers seeded
+   *                 with seed + n
+   */
+  MachinePool(const std::vector<byte_t> &program,
+              uint32_t                   capacity,
+              uint64_t                   seed = 0);
+
+  /**
+   * A machine in the state right after loading the program, nullptr if all
+   * are in use.
+   */
+  Machine *acquire();
+
+  /**
+   * Give a machine back. Its state is left as it is until the next
+   * acquire(). The machine has to come from acquire() of this pool and may
+   * only be given back once, which gets asserted.
+   */
+  void release(Machine *machine);
+
+  uint32_t get_capacity() const { return capacity; }
+
+  uint32_t get_free_count() const { return free_machines.size(); }
+
+  const CpuState &get_initial_state() const { return initial_state; }
+
+private:
+  const uint32_t capacity;
+
+  CpuState initial_state{};
+  uint64_t next_seed;
+
+  std::unique_ptr<Machine[]> machines;
+
+  /**
+   * Indices of the machines not in use, the last released one on top, as
+   * its lines are most likely still in the cache.
+   */
+  std::vector<uint32_t> free_machines{};
+
+  std::vector<bool> in_use;
+};
+
+} // namespace Chip8
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cpu.hpp"
+#include "headless_keyboard.hpp"
+#include "run_cache.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+/**
+ * FNV-1a with 64 bits, fed field by field.
+ */
+class Hasher
+{
+public:
+  template <typename T> void add(const T &value)
+  {
+    add(reinterpret_cast<const byte_t *>(&value), sizeof(value));
+  }
+
+  void add(const byte_t *data, size_t size)
+  {
+    for (size_t i = 0; i < size; ++i)
+    {
+      hash = (hash ^ data[i]) * 0x100000001b3;
+    }
+  }
+
+  uint64_t get() const { return hash; }
+
+private:
+  uint64_t hash = 0xcbf29ce484222325;
+};
+
+struct Header
+{
+  char     magic[8]   = {'C', 'H', 'I', 'P', '8', 'R', 'U', 'N'};
+  uint32_t version    = run_cache_version;
+  uint32_t state_size = sizeof(CpuState);
+  uint64_t key        = 0;
+  uint64_t cycle      = 0;
+};
+
+/**
+ * Keys of the states after each cycle in the list, which has to be sorted.
+ */
+std::vector<uint64_t> make_keys(const RunInput              &input,
+                                const std::vector<uint64_t> &cycles)
+{
+  Hasher hasher;
+  hasher.add(run_cache_version);
+  hasher.add(uint32_t(sizeof(CpuState)));
+  hasher.add(input.seed);
+  hasher.add(uint64_t(input.program.size()));
+  hasher.add(input.program.data(), input.program.size());
+
+  std::vector<uint64_t> keys;
+  size_t                next_event = 0;
+  for (const uint64_t cycle : cycles)
+  {
+    // Only the events that happened before the cycle
+    while (next_event < input.key_script.size() &&
+           input.key_script[next_event].cycle < cycle)
+    {
+      hasher.add(input.key_script[next_event].cycle);
+      hasher.add(input.key_script[next_event].keys);
+      ++next_event;
+    }
+
+    Hasher with_cycle = hasher;
+    with_cycle.add(cycle);
+    keys.push_back(with_cycle.get());
+  }
+  return keys;
+}
+
+} // namespace
+
+RunCache::RunCache(const std::string &directory, uint64_t checkpoint_interval)
+    : directory(directory), checkpoint_interval(checkpoint_interval)
+{
+  // The parent of the default directory may be missing as well
+  const size_t slash = directory.rfind('/');
+  if (slash != std::string::npos && slash > 0)
+  {
+    mkdir(directory.substr(0, slash).c_str(), 0755);
+  }
+  mkdir(directory.c_str(), 0755);
+}
+
+RunResult RunCache::run(const RunInput &input, uint64_t cycles) const
+{
+  // Checkpoints before the end, and the end
+  std::vector<uint64_t> stops;
+  for (uint64_t cycle = checkpoint_interval;
+       checkpoint_interval > 0 && cycle < cycles; cycle += checkpoint_interval)
+  {
+    stops.push_back(cycle);
+  }
+  stops.push_back(cycles);
+
+  const std::vector<uint64_t> keys = make_keys(input, stops);
+
+  auto  new_keyboard = std::make_unique<HeadlessKeyboard>();
+  auto *keyboard     = new_keyboard.get();
+
+  Cpu cpu(std::move(new_keyboard));
+  cpu.init();
+  cpu.load_program(input.program);
+
+  RunResult result;
+  result.state = cpu.get_state();
+  result.state.random_engine.seed(input.seed);
+
+  // Latest state on the way that is cached
+  size_t next_stop = 0;
+  for (size_t i = stops.size(); i-- > 0;)
+  {
+    if (load(keys[i], stops[i], result.state))
+    {
+      result.resumed_from = stops[i];
+      next_stop           = i + 1;
+      break;
+    }
+  }
+  cpu.set_state(result.state);
+
+  // Keys held down at the start
+  size_t next_event = 0;
+  while (next_event < input.key_script.size() &&
+         input.key_script[next_event].cycle < result.resumed_from)
+  {
+    keyboard->set_keys(input.key_script[next_event++].keys);
+  }
+
+  for (uint64_t cycle = result.resumed_from; next_stop < stops.size();)
+  {
+    while (next_event < input.key_script.size() &&
+           input.key_script[next_event].cycle <= cycle)
+    {
+      keyboard->set_keys(input.key_script[next_event++].keys);
+    }
+
+    // Run up to the next key event or stop, whatever comes first
+    uint64_t until = stops[next_stop];
+    if (next_event < input.key_script.size())
+    {
+      until = std::min(until, input.key_script[next_event].cycle);
+    }
+    while (cycle < until)
+    {
+      const auto batch = uint32_t(std::min<uint64_t>(until - cycle, 1 << 30));
+      cpu.run(batch);
+      cycle += batch;
+    }
+
+    if (cycle == stops[next_stop])
+    {
+      store(keys[next_stop], cycle, cpu.get_state());
+      ++next_stop;
+    }
+  }
+
+  result.state = cpu.get_state();
+  result.hash  = hash_state(result.state);
+  return result;
+}
+
+std::string RunCache::get_path(uint64_t key, uint64_t cycle) const
+{
+  char name[64];
+  std::snprintf(name, sizeof(name), "/%016llx-%llu.state",
+                static_cast<unsigned long long>(key),
+                static_cast<unsigned long long>(cycle));
+  return directory + name;
+}
+
+bool RunCache::load(uint64_t key, uint64_t cycle, CpuState &state) const
+{
+  std::ifstream in(get_path(key, cycle), std::ios::in | std::ios::binary);
+
+  Header header;
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, Header().magic, sizeof(header.magic)) != 0 ||
+      header.version != run_cache_version ||
+      header.state_size != sizeof(CpuState) || header.key != key ||
+      header.cycle != cycle)
+  {
+    return false;
+  }
+
+  CpuState loaded;
+  if (!in.read(reinterpret_cast<char *>(&loaded), sizeof(loaded)))
+  {
+    return false;
+  }
+  state = loaded;
+  return true;
+}
+
+void RunCache::store(uint64_t key, uint64_t cycle, const CpuState &state) const
+{
+  const std::string path = get_path(key, cycle);
+
+  struct stat existing;
+  if (stat(path.c_str(), &existing) == 0)
+  {
+    return;
+  }
+
+  Header header;
+  header.key   = key;
+  header.cycle = cycle;
+
+  // Written aside and renamed, so that a parallel run never reads half a
+  // state. Failures only cost the cache entry.
+  const std::string temporary_path =
+      path + "." + std::to_string(getpid()) + ".tmp";
+  {
+    std::ofstream out(temporary_path,
+                      std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(&state), sizeof(state));
+    if (!out)
+    {
+      return;
+    }
+  }
+  std::rename(temporary_path.c_str(), path.c_str());
+}
+
+} // namespace Chip8
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu_state.hpp"
+#include "key_script.hpp"
+#include "state_hash.hpp"
+
+namespace Chip8
+{
+
+/**
+ * Version of the results of the core. Bump it with every change that makes
+ * a program run differently, e.g. a fixed instruction, so that RunCache
+ * stops handing out states of the old core.
+ */
+constexpr uint32_t run_cache_version = 1;
+
+/**
+ * @brief Everything a deterministic run depends on, besides its length.
+ */
+struct RunInput
+{
+  std::vector<byte_t>   program{};
+  std::vector<KeyEvent> key_script{};
+
+  /**
+   * Seed of the random numbers of CXNN.
+   */
+  uint64_t seed = 0;
+};
+
+struct RunResult
+{
+  CpuState  state{};
+  StateHash hash{};
+
+  /**
+   * Cycle the run continued from a cached state, 0 if it started at reset.
+   * Equal to the length of the run if nothing had to run at all.
+   */
+  uint64_t resumed_from = 0;
+};
+
+/**
+ * @brief Stores machine states of deterministic runs on disk, so that runs
+ * that were done before get skipped.
+ *
+ * The state after N cycles only depends on the program, the seed, the key
+ * events before cycle N and the version of the core. States get stored
+ * under a hash of exactly these and N. A run finds the final state of an
+ * equal run, or the latest checkpoint of any run that shares a prefix with
+ * it, including runs whose key scripts only differ later on.
+ */
+class RunCache
+{
+public:
+  /**
+   * @param directory           Where to keep the states, created if missing
+   * @param checkpoint_interval Store a state every N cycles besides the
+   *                            final one, 0 for none
+   */
+  RunCache(const std::string &directory, uint64_t checkpoint_interval);
+
+  /**
+   * Run a program for a number of cycles on the interpreter. Starts from the
+   * latest cached state of the run, and stores the checkpoints it passes
+   * and the final state.
+   *
+   * Throws a exception if the program is to long.
+   */
+  RunResult run(const RunInput &input, uint64_t cycles) const;
+
+private:
+  const std::string directory;
+  const uint64_t    checkpoint_interval;
+
+  std::string get_path(uint64_t key, uint64_t cycle) const;
+
+  bool load(uint64_t key, uint64_t cycle, CpuState &state) const;
+
+  void store(uint64_t key, uint64_t cycle, const CpuState &state) const;
+};
+
+} // namespace Chip8
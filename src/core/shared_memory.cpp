@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <bitset>
+
+#include "cpu.hpp"
+#include "headless_keyboard.hpp"
+#include "shared_memory.hpp"
+
+namespace Chip8
+{
+
+SharedMemory::SharedMemory(std::shared_ptr<const Image> image)
+    : image(std::move(image))
+{
+  reset();
+}
+
+void SharedMemory::reset()
+{
+  for (uint32_t page = 0; page < page_count; ++page)
+  {
+    pages[page] = image->data() + page * page_size;
+  }
+
+  owned_pages = 0;
+  private_pages.clear();
+}
+
+uint32_t SharedMemory::get_owned_page_count() const
+{
+  return std::bitset<page_count>(owned_pages).count();
+}
+
+void SharedMemory::copy_page(uint32_t page)
+{
+  auto copy = std::make_unique<Page>();
+  std::copy(pages[page], pages[page] + page_size, copy->begin());
+
+  pages[page] = copy->data();
+  owned_pages |= 1 << page;
+  private_pages.push_back(std::move(copy));
+}
+
+std::shared_ptr<const SharedMemory::Image>
+make_memory_image(const std::vector<byte_t> &program)
+{
+  // Load through a cpu, so the image matches what a single machine gets
+  Cpu cpu(std::make_unique<HeadlessKeyboard>());
+  cpu.init();
+  cpu.load_program(program);
+
+  return std::make_shared<const SharedMemory::Image>(cpu.get_state().memory);
+}
+
+} // namespace Chip8
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "cpu_state.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief Memory of one machine in a batch, backed by a memory image that
+ * all machines share.
+ *
+ * The memory is split into pages. Every page starts out pointing into the
+ * shared image, which holds the sprites and the program. The first write
+ * to a page, which only FX33 and FX55 do, gives the machine a private copy
+ * of it. A machine that never writes owns no memory at all.
+ *
+ * Addresses wrap at 4096, so a stray I register can not reach outside of
+ * the page table.
+ */
+class SharedMemory
+{
+public:
+  static constexpr uint32_t page_size  = 256;
+  static constexpr uint32_t page_count = 4096 / page_size;
+
+  using Image = FlatMemory;
+
+  SharedMemory() = default;
+
+  explicit SharedMemory(std::shared_ptr<const Image> image);
+
+  byte_t operator[](uint32_t address) const
+  {
+    address &= 0xFFF;
+    return pages[address / page_size][address % page_size];
+  }
+
+  void write(uint32_t address, byte_t value)
+  {
+    address &= 0xFFF;
+
+    const uint32_t page = address / page_size;
+    if (!(owned_pages >> page & 1))
+    {
+      copy_page(page);
+    }
+    // Private pages are the only ones written to
+    const_cast<byte_t *>(pages[page])[address % page_size] = value;
+  }
+
+  /**
+   * Drop all private pages and go back to the shared image.
+   */
+  void reset();
+
+  uint32_t get_owned_page_count() const;
+
+  /**
+   * Bytes this machine owns outside of the object itself.
+   */
+  size_t get_owned_size() const { return get_owned_page_count() * page_size; }
+
+private:
+  using Page = std::array<byte_t, page_size>;
+
+  std::shared_ptr<const Image> image{};
+
+  /**
+   * Where each page currently lives, in the image or in a private copy.
+   */
+  std::array<const byte_t *, page_count> pages{};
+
+  /**
+   * Bit n is set if page n is a private copy.
+   */
+  uint16_t owned_pages = 0;
+
+  std::vector<std::unique_ptr<Page>> private_pages{};
+
+  void copy_page(uint32_t page);
+};
+
+static_assert(SharedMemory::page_count <= 16,
+              "owned_pages needs a bit per page");
+
+inline void write_memory(SharedMemory &memory, uint32_t address, byte_t value)
+{
+  memory.write(address, value);
+}
+
+/**
+ * State of a machine in a batch.
+ */
+using SharedCpuState = BasicCpuState<SharedMemory>;
+
+/**
+ * Build the memory image of a program, with the sprites and the program
+ * loaded like Cpu::init() and Cpu::load_program() do.
+ *
+ * Throws a exception if the program is to long.
+ */
+std::shared_ptr<const SharedMemory::Image>
+make_memory_image(const std::vector<byte_t> &program);
+
+} // namespace Chip8
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cstring>
+
+#include "interpreter.hpp"
+#include "state_hash.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+constexpr uint32_t words_per_row = display_width / 8;
+
+/**
+ * Finalizer of splitmix64. Cheap and mixes all bits.
+ */
+uint64_t mix(uint64_t value)
+{
+  value ^= value >> 30;
+  value *= 0xBF58476D1CE4E5B9ull;
+  value ^= value >> 27;
+  value *= 0x94D049BB133111EBull;
+  value ^= value >> 31;
+  return value;
+}
+
+uint64_t load_word(const byte_t *data)
+{
+  uint64_t word;
+  std::memcpy(&word, data, sizeof(word));
+  return word;
+}
+
+/**
+ * Sum of the hashes of the words [begin, end) of data.
+ */
+uint64_t hash_words(const byte_t *data, uint32_t begin, uint32_t end)
+{
+  uint64_t hash = 0;
+  for (uint32_t i = begin; i < end; ++i)
+  {
+    hash += mix(load_word(data + i * 8) ^ (uint64_t(i) << 52));
+  }
+  return hash;
+}
+
+uint64_t hash_registers(const CpuState &state)
+{
+  uint64_t hash = mix(uint64_t(state.i_register) |
+                      uint64_t(state.pc_register) << 16 |
+                      uint64_t(state.timer_delay_register) << 32 |
+                      uint64_t(state.sound_delay_register) << 40 |
+                      uint64_t(state.sp_register) << 48 |
+                      uint64_t(state.paused) << 56);
+
+  hash = mix(hash ^ load_word(&state.v_registers[0]));
+  hash = mix(hash ^ load_word(&state.v_registers[8]));
+
+  const auto stack = reinterpret_cast<const byte_t *>(state.stack.data());
+  for (uint32_t i = 0; i < sizeof(state.stack) / 8; ++i)
+  {
+    hash = mix(hash ^ load_word(stack + i * 8));
+  }
+
+  return hash;
+}
+
+} // namespace
+
+StateHash hash_state(const CpuState &state)
+{
+  StateHash hash;
+  hash.registers   = hash_registers(state);
+  hash.memory      = hash_words(state.memory.data(), 0, memory_size / 8);
+  hash.framebuffer = hash_words(state.framebuffer[0].data(),
+                                0,
+                                display_height * words_per_row);
+  return hash;
+}
+
+void IncrementalStateHash::reset(const CpuState &state)
+{
+  hash = hash_state(state);
+}
+
+void DirtyRegion::merge(const DirtyRegion &other)
+{
+  if (other.memory_begin < other.memory_end)
+  {
+    if (memory_begin < memory_end)
+    {
+      memory_begin = std::min(memory_begin, other.memory_begin);
+      memory_end   = std::max(memory_end, other.memory_end);
+    }
+    else
+    {
+      memory_begin = other.memory_begin;
+      memory_end   = other.memory_end;
+    }
+  }
+  rows |= other.rows;
+}
+
+DirtyRegion get_dirty_region(const CpuState &state)
+{
+  DirtyRegion region;
+
+  if (state.paused)
+  {
+    return region;
+  }
+
+  const dbyte_t opcode = fetch_opcode(state);
+  const byte_t  x      = (opcode & 0x0F00) >> 8;
+  const byte_t  y      = (opcode & 0x00F0) >> 4;
+
+  uint32_t store_size = 0;
+
+  if (opcode == 0x00E0)
+  {
+    region.rows = 0xFFFFFFFF;
+  }
+  else if ((opcode & 0xF000) == 0xD000)
+  {
+    for (uint32_t row = 0; row < (opcode & 0xFu); ++row)
+    {
+      region.rows |= 1u << ((state.v_registers[y] + row) % display_height);
+    }
+  }
+  else if ((opcode & 0xF0FF) == 0xF033)
+  {
+    store_size = 3;
+  }
+  else if ((opcode & 0xF0FF) == 0xF055)
+  {
+    store_size = x + 1;
+  }
+
+  if (store_size > 0)
+  {
+    const uint32_t begin = mask_address(state.i_register);
+    const uint32_t end   = begin + store_size;
+
+    // A store that wraps around is rare enough to hash all of memory for
+    if (end > memory_size)
+    {
+      region.memory_begin = 0;
+      region.memory_end   = memory_size / 8;
+    }
+    else
+    {
+      region.memory_begin = begin / 8;
+      region.memory_end   = (end + 7) / 8;
+    }
+  }
+
+  return region;
+}
+
+void IncrementalStateHash::begin(const CpuState &state)
+{
+  begin(state, get_dirty_region(state));
+}
+
+void IncrementalStateHash::begin(const CpuState    &state,
+                                 const DirtyRegion &new_region)
+{
+  region = new_region;
+  update(state, false);
+}
+
+void IncrementalStateHash::end(const CpuState &state)
+{
+  hash.registers = hash_registers(state);
+  update(state, true);
+}
+
+void IncrementalStateHash::update(const CpuState &state, bool add)
+{
+  const uint64_t memory_hash =
+      hash_words(state.memory.data(), region.memory_begin, region.memory_end);
+
+  uint64_t framebuffer_hash = 0;
+  for (uint32_t row = 0; row < display_height && region.rows >> row; ++row)
+  {
+    if ((region.rows >> row) & 1)
+    {
+      framebuffer_hash += hash_words(state.framebuffer[0].data(),
+                                     row * words_per_row,
+                                     (row + 1) * words_per_row);
+    }
+  }
+
+  if (add)
+  {
+    hash.memory      += memory_hash;
+    hash.framebuffer += framebuffer_hash;
+  }
+  else
+  {
+    hash.memory      -= memory_hash;
+    hash.framebuffer -= framebuffer_hash;
+  }
+}
+
+} // namespace Chip8
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cpu_state.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief Hash of a cpu state, split up by parts of the state.
+ *
+ * Memory and framebuffer get hashed as sum of the hashes of their 64 bit
+ * words, so a changed word can be swapped out without rehashing the rest.
+ */
+struct StateHash
+{
+  /**
+   * Registers, stack and pause flag.
+   */
+  uint64_t registers{};
+
+  uint64_t memory{};
+
+  uint64_t framebuffer{};
+
+  bool operator==(const StateHash &other) const
+  {
+    return registers == other.registers && memory == other.memory &&
+           framebuffer == other.framebuffer;
+  }
+
+  bool operator!=(const StateHash &other) const { return !(*this == other); }
+};
+
+/**
+ * Hash the complete state.
+ */
+StateHash hash_state(const CpuState &state);
+
+/**
+ * @brief Parts of memory and of the framebuffer that one instruction, or a
+ * run of them, may write.
+ */
+struct DirtyRegion
+{
+  /**
+   * Words of memory [memory_begin, memory_end).
+   */
+  uint32_t memory_begin = 0;
+  uint32_t memory_end   = 0;
+
+  /**
+   * Bit n is set for row n of the framebuffer.
+   */
+  uint32_t rows = 0;
+
+  /**
+   * Grow to also cover the other region. Memory stays a single range.
+   */
+  void merge(const DirtyRegion &other);
+};
+
+/**
+ * What the next instruction of the state may write.
+ */
+DirtyRegion get_dirty_region(const CpuState &state);
+
+/**
+ * @brief Keeps the hash of a state up to date while instructions run.
+ *
+ * Only the parts an instruction can write get rehashed. Call begin()
+ * before and end() after each cycle.
+ */
+class IncrementalStateHash
+{
+public:
+  /**
+   * Hash the complete state.
+   */
+  void reset(const CpuState &state);
+
+  /**
+   * Remove the parts the next instruction writes from the hash.
+   */
+  void begin(const CpuState &state);
+
+  /**
+   * Remove the given parts from the hash, for a run of instructions whose
+   * writes are known from elsewhere, e.g. from a second machine running
+   * the same code.
+   */
+  void begin(const CpuState &state, const DirtyRegion &region);
+
+  /**
+   * Add the parts written by the instruction back to the hash.
+   */
+  void end(const CpuState &state);
+
+  const StateHash &get() const { return hash; }
+
+  /**
+   * Parts removed by the last begin().
+   */
+  const DirtyRegion &get_region() const { return region; }
+
+private:
+  StateHash   hash{};
+  DirtyRegion region{};
+
+  void update(const CpuState &state, bool add);
+};
+
+} // namespace Chip8
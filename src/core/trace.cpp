@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include "trace.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+uint32_t next_power_of_two(uint32_t value)
+{
+  uint32_t result = 1;
+  while (result < value)
+  {
+    result <<= 1;
+  }
+  return result;
+}
+
+} // namespace
+
+uint32_t written_registers(dbyte_t opcode)
+{
+  const uint32_t vx = 1u << ((opcode >> 8) & 0xF);
+  const uint32_t vf = 1u << 0xF;
+
+  switch (opcode & 0xF000)
+  {
+  case 0x6000:
+  case 0x7000:
+  case 0xC000:
+    return vx;
+
+  case 0x8000:
+    switch (opcode & 0xF)
+    {
+    case 0x0:
+    case 0x1:
+    case 0x2:
+    case 0x3:
+      return vx;
+
+    case 0x4:
+    case 0x5:
+    case 0x6:
+    case 0x7:
+    case 0xE:
+      return vx | vf;
+    }
+    return 0;
+
+  case 0xD000:
+    return vf;
+
+  case 0xF000:
+    switch (opcode & 0xFF)
+    {
+    case 0x07:
+      return vx;
+
+    case 0x65:
+      // V0 to VX
+      return (vx << 1) - 1;
+    }
+    return 0;
+
+  default:
+    return 0;
+  }
+}
+
+bool TraceHeader::is_compatible() const
+{
+  const TraceHeader current;
+  return std::memcmp(magic, current.magic, sizeof(magic)) == 0 &&
+         version == current.version && record_size == current.record_size;
+}
+
+Tracer::Tracer(const std::string &path, uint32_t capacity)
+    : path(path),
+      records(std::make_unique<TraceRecord[]>(next_power_of_two(capacity))),
+      mask(next_power_of_two(capacity) - 1),
+      batch_size(std::max(1u, (mask + 1) / 4))
+{
+  out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    throw std::runtime_error("Could not open trace file " + path);
+  }
+
+  const TraceHeader header;
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  writer_thread = std::thread(&Tracer::write_loop, this);
+}
+
+Tracer::~Tracer() { stop(); }
+
+void Tracer::stop()
+{
+  if (!writer_thread.joinable())
+  {
+    return;
+  }
+
+  head.store(next, std::memory_order_release);
+  running = false;
+  wake.notify_one();
+  writer_thread.join();
+
+  out.close();
+}
+
+void Tracer::publish()
+{
+  head.store(next, std::memory_order_release);
+  wake.notify_one();
+
+  while (next + batch_size - tail.load(std::memory_order_acquire) > mask + 1)
+  {
+    wake.notify_one();
+    std::this_thread::yield();
+  }
+  limit = next + batch_size;
+}
+
+void Tracer::write_loop()
+{
+  for (;;)
+  {
+    // Read before head: stop() stores the last head before it clears
+    // running, so an empty ring after a cleared running is really empty
+    const bool     was_running  = running;
+    const uint32_t current_tail = tail.load(std::memory_order_relaxed);
+    const uint32_t current_head = head.load(std::memory_order_acquire);
+
+    if (current_tail != current_head)
+    {
+      // Write up to the end of the ring, the rest follows next round
+      const uint32_t begin = current_tail & mask;
+      const uint32_t count =
+          std::min(current_head - current_tail, mask + 1 - begin);
+
+      out.write(reinterpret_cast<const char *>(&records[begin]),
+                count * sizeof(TraceRecord));
+
+      tail.store(current_tail + count, std::memory_order_release);
+      written_records += count;
+      continue;
+    }
+
+    if (!was_running)
+    {
+      out.flush();
+      return;
+    }
+
+    // The producer notifies without taking the lock, so a wake up can get
+    // lost. The timeout bounds the latency in that case.
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    wake.wait_for(lock, std::chrono::milliseconds(5));
+  }
+}
+
+} // namespace Chip8
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "cpu_state.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief One executed instruction in a trace file.
+ *
+ * Registers are the values after the instruction ran and the timers
+ * ticked. Records are written in host byte order.
+ */
+struct TraceRecord
+{
+  /**
+   * Number of the traced instruction, wraps at 2^32.
+   */
+  uint32_t cycle;
+
+  dbyte_t pc;
+  dbyte_t opcode;
+  dbyte_t i_register;
+
+  /**
+   * Values of VX, where X is the second nibble of the opcode, and of VF.
+   * Every instruction that writes registers writes one of these, which ones
+   * follows from the opcode, see written_registers().
+   */
+  byte_t vx;
+  byte_t vf;
+
+  byte_t timer_delay;
+  byte_t timer_sound;
+  byte_t paused;
+  byte_t reserved;
+};
+
+static_assert(sizeof(TraceRecord) == 16, "Trace records have a fixed size");
+
+/**
+ * Registers an instruction writes. Bit n is set for Vn.
+ */
+uint32_t written_registers(dbyte_t opcode);
+
+/**
+ * @brief Start of a trace file, followed by the records.
+ */
+struct TraceHeader
+{
+  char     magic[8]    = {'C', 'H', 'I', 'P', '8', 'T', 'R', 'C'};
+  uint32_t version     = 1;
+  uint32_t record_size = sizeof(TraceRecord);
+
+  /**
+   * Check magic, version and record size against the ones of this build.
+   */
+  bool is_compatible() const;
+};
+
+/**
+ * @brief Records every executed instruction into a binary trace file.
+ *
+ * The emulation thread fills a ring of records and a background thread
+ * writes them out. Recording an instruction is a few stores and a single
+ * branch, the ring gets synchronized once per batch of records and never
+ * with a lock. Unlike FrameRecorder no record is ever dropped: if the
+ * writer falls behind the emulation thread waits for it, since a trace with
+ * holes is of no use for finding a divergence.
+ */
+class Tracer
+{
+public:
+  /**
+   * Throws a exception if the trace file can not be opened.
+   *
+   * @param path     Trace file to write
+   * @param capacity Number of records in the ring, rounded up to a power
+   *                 of two
+   */
+  explicit Tracer(const std::string &path, uint32_t capacity = 1 << 16);
+
+  ~Tracer();
+
+  Tracer(const Tracer &) = delete;
+  Tracer &operator=(const Tracer &) = delete;
+
+  /**
+   * Record an instruction.
+   *
+   * @param pc     Address the instruction was fetched from
+   * @param opcode The instruction
+   * @param state  State after the instruction ran
+   */
+  template <typename State>
+  void record(dbyte_t pc, dbyte_t opcode, const State &state)
+  {
+    // One branch per record, the ring is only checked once per batch
+    if (next == limit)
+    {
+      publish();
+    }
+
+    // Plain copies only. Working out what changed is left to the decoder.
+    TraceRecord &entry = records[next & mask];
+    entry.cycle        = next;
+    entry.pc           = pc;
+    entry.opcode       = opcode;
+    entry.i_register   = state.i_register;
+    entry.vx           = state.v_registers[(opcode >> 8) & 0xF];
+    entry.vf           = state.v_registers[0xF];
+    entry.timer_delay  = state.timer_delay_register;
+    entry.timer_sound  = state.sound_delay_register;
+    entry.paused       = state.paused;
+    entry.reserved     = 0;
+
+    ++next;
+  }
+
+  /**
+   * Write all pending records and close the file. Has to be called from the
+   * thread that records, or after it stopped recording.
+   */
+  void stop();
+
+  uint64_t get_written_records() const { return written_records; }
+
+  const std::string &get_path() const { return path; }
+
+private:
+  const std::string path;
+
+  std::unique_ptr<TraceRecord[]> records;
+  const uint32_t                 mask;
+
+  /**
+   * Records get handed to the writer in batches of a quarter of the ring.
+   */
+  const uint32_t batch_size;
+
+  /**
+   * Only touched by the emulation thread. Number of the next record, and
+   * the end of the batch claimed from the ring.
+   */
+  uint32_t next  = 0;
+  uint32_t limit = 0;
+
+  alignas(64) std::atomic<uint32_t> head{0};
+  alignas(64) std::atomic<uint32_t> tail{0};
+
+  std::ofstream out{};
+
+  std::atomic<uint64_t> written_records{0};
+
+  std::atomic<bool>       running{true};
+  std::mutex              wake_mutex{};
+  std::condition_variable wake{};
+  std::thread             writer_thread{};
+
+  /**
+   * Hand the records of the batch to the writer and wait until there is
+   * space for the next one.
+   */
+  void publish();
+
+  void write_loop();
+};
+
+} // namespace Chip8
@@ -0,0 +1,205 @@
+#include <algorithm>
+
+#include "interpreter.hpp"
+#include "vec_env.hpp"
+
+namespace Chip8
+{
+
+namespace
+{
+
+constexpr uint32_t all_rows = ~0u;
+
+static_assert(display_height == 32, "Dirty rows need a bit per row");
+
+/**
+ * Rows a DXYN instruction draws to, before it runs.
+ */
+template <typename State>
+uint32_t get_sprite_rows(const State &state, dbyte_t opcode)
+{
+  const uint32_t y = (opcode & 0x00F0) >> 4;
+  if (y == 0xF)
+  {
+    // VF changes while the sprite gets drawn
+    return all_rows;
+  }
+
+  const uint32_t height = opcode & 0xF;
+  const uint64_t rows   = uint64_t((1u << height) - 1)
+                        << state.v_registers[y] % display_height;
+
+  // Rows past the bottom wrap around to the top
+  return uint32_t(rows) | uint32_t(rows >> display_height);
+}
+
+} // namespace
+
+VecEnv::VecEnv(const std::vector<byte_t> &program,
+               uint32_t                   count,
+               uint32_t                   cycles_per_frame,
+               uint32_t                   thread_count,
+               uint64_t                   seed)
+    : cycles_per_frame(cycles_per_frame),
+      seed(seed),
+      image(make_memory_image(program)),
+      instances(count),
+      dirty_rows(count)
+{
+  // The instances never move after this, the framebuffer view points into
+  // them
+  reset();
+
+  if (thread_count == 0)
+  {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  thread_count = std::max(1u, std::min(thread_count, count));
+
+  for (uint32_t thread = 1; thread < thread_count; ++thread)
+  {
+    workers.emplace_back(&VecEnv::work, this, thread);
+  }
+}
+
+VecEnv::~VecEnv()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  start.notify_all();
+
+  for (auto &worker : workers)
+  {
+    worker.join();
+  }
+}
+
+void VecEnv::step(const uint16_t *new_actions)
+{
+  if (!workers.empty())
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      actions = new_actions;
+      pending = workers.size();
+      ++generation;
+    }
+    start.notify_all();
+  }
+
+  step_range(0, new_actions);
+
+  if (!workers.empty())
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return pending == 0; });
+  }
+}
+
+void VecEnv::reset(uint32_t index)
+{
+  Instance &instance = instances[index];
+
+  instance.state = SharedCpuState{SharedMemory(image)};
+  instance.state.random_engine.seed(seed + index);
+  instance.keyboard.set_keys(0);
+
+  dirty_rows[index] = all_rows;
+}
+
+void VecEnv::reset()
+{
+  for (uint32_t i = 0; i < instances.size(); ++i)
+  {
+    reset(i);
+  }
+}
+
+const byte_t *VecEnv::get_framebuffers() const
+{
+  return instances.empty() ? nullptr
+                           : instances[0].state.framebuffer[0].data();
+}
+
+void VecEnv::clear_dirty_rows()
+{
+  std::fill(dirty_rows.begin(), dirty_rows.end(), 0);
+}
+
+size_t VecEnv::get_memory_usage() const
+{
+  size_t usage = sizeof(SharedMemory::Image) + sizeof(Instance) * size();
+  for (const auto &instance : instances)
+  {
+    usage += instance.state.memory.get_owned_size();
+  }
+  return usage;
+}
+
+void VecEnv::work(uint32_t thread)
+{
+  uint64_t seen = 0;
+
+  for (;;)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    start.wait(lock, [&] { return stopping || generation != seen; });
+    if (stopping)
+    {
+      return;
+    }
+    seen = generation;
+
+    const uint16_t *step_actions = actions;
+    lock.unlock();
+
+    step_range(thread, step_actions);
+
+    lock.lock();
+    if (--pending == 0)
+    {
+      done.notify_one();
+    }
+  }
+}
+
+void VecEnv::step_range(uint32_t thread, const uint16_t *step_actions)
+{
+  const uint64_t count   = instances.size();
+  const uint64_t threads = get_thread_count();
+
+  const uint32_t begin = count * thread / threads;
+  const uint32_t end   = count * (thread + 1) / threads;
+
+  for (uint32_t i = begin; i < end; ++i)
+  {
+    Instance &instance = instances[i];
+    instance.keyboard.set_keys(step_actions[i]);
+
+    // Same as cycle(), with the rows drawn to collected on the way
+    uint32_t rows = 0;
+    for (uint32_t cycles = 0;
+         cycles < cycles_per_frame && !instance.state.paused; ++cycles)
+    {
+      const dbyte_t opcode = fetch_opcode(instance.state);
+      if ((opcode & 0xF000) == 0xD000)
+      {
+        rows |= get_sprite_rows(instance.state, opcode);
+      }
+      else if (opcode == 0x00E0)
+      {
+        rows = all_rows;
+      }
+
+      interpret(instance.state, opcode, instance.keyboard);
+      instance.state.pc_register += 2;
+      update_timers(instance.state);
+    }
+    dirty_rows[i] |= rows;
+  }
+}
+
+} // namespace Chip8
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "headless_keyboard.hpp"
+#include "shared_memory.hpp"
+
+namespace Chip8
+{
+
+/**
+ * @brief A batch of machines running the same program, stepped together.
+ *
+ * Meant for reinforcement learning, where many environments advance one
+ * frame at a time with a separate input each. Stepping is spread across a
+ * pool of threads. The machines live in one array, so their framebuffers
+ * are evenly spaced in memory and can be viewed without copying.
+ *
+ * The machines share the memory image of the program, see SharedMemory,
+ * which keeps a machine at about a third of the size of a Cpu.
+ *
+ * Every instance also tracks the display rows it drew to, so that viewers
+ * only copy those.
+ */
+class VecEnv
+{
+public:
+  /**
+   * Throws a exception if the program is to long.
+   *
+   * @param program          Program all instances run
+   * @param count            Number of instances
+   * @param cycles_per_frame Cycles each instance runs per step
+   * @param thread_count     Threads to step with, 0 for one per core
+   * @param seed             Instance n draws random numbers seeded with
+   *                         seed + n
+   */
+  VecEnv(const std::vector<byte_t> &program,
+         uint32_t                   count,
+         uint32_t                   cycles_per_frame = 1,
+         uint32_t                   thread_count     = 0,
+         uint64_t                   seed             = 0);
+
+  ~VecEnv();
+
+  VecEnv(const VecEnv &) = delete;
+  VecEnv &operator=(const VecEnv &) = delete;
+
+  /**
+   * Run one frame on every instance.
+   *
+   * @param actions Pressed keys of every instance, bit n is key n
+   */
+  void step(const uint16_t *actions);
+
+  /**
+   * Put an instance back into the state right after loading the program.
+   */
+  void reset(uint32_t index);
+
+  void reset();
+
+  uint32_t size() const { return instances.size(); }
+
+  bool is_paused(uint32_t index) const
+  {
+    return instances[index].state.paused;
+  }
+
+  /**
+   * Framebuffer of the first instance. The one of instance n starts
+   * n * get_framebuffer_stride() bytes after it.
+   */
+  const byte_t *get_framebuffers() const;
+
+  size_t get_framebuffer_stride() const { return sizeof(Instance); }
+
+  /**
+   * Rows each instance may have changed since the last clear_dirty_rows(),
+   * bit n for row n. DXYN marks the rows of the sprite, 00E0 and a reset
+   * all rows.
+   */
+  const uint32_t *get_dirty_rows() const { return dirty_rows.data(); }
+
+  void clear_dirty_rows();
+
+  uint32_t get_thread_count() const { return workers.size() + 1; }
+
+  /**
+   * Bytes used by the machines, including their private pages and the
+   * shared memory image.
+   */
+  size_t get_memory_usage() const;
+
+private:
+  struct Instance
+  {
+    SharedCpuState   state;
+    HeadlessKeyboard keyboard{};
+  };
+
+  const uint32_t cycles_per_frame;
+  const uint64_t seed;
+
+  std::shared_ptr<const SharedMemory::Image> image{};
+  std::vector<Instance>                      instances{};
+  std::vector<uint32_t>                      dirty_rows{};
+
+  std::vector<std::thread> workers{};
+
+  std::mutex              mutex{};
+  std::condition_variable start{};
+  std::condition_variable done{};
+  uint64_t                generation = 0;
+  uint32_t                pending    = 0;
+  bool                    stopping   = false;
+  const uint16_t         *actions{};
+
+  void work(uint32_t thread);
+
+  /**
+   * Step the instances of a thread. The main thread is thread 0.
+   */
+  void step_range(uint32_t thread, const uint16_t *actions);
+};
+
+} // namespace Chip8
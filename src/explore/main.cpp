@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cpu.hpp"
+#include "explorer.hpp"
+#include "headless_keyboard.hpp"
+
+void print_usage(const char *program_name)
+{
+  std::cerr << "Usage: " << program_name << " [OPTIONS] PROGRAM_FILEPATH"
+            << std::endl
+            << std::endl
+            << "Search the states a program reaches when each of the 16 keys "
+               "is held down for"
+            << std::endl
+            << "some frames, step after step, and report how many distinct "
+               "states there are."
+            << std::endl
+            << std::endl
+            << "Options:" << std::endl
+            << "  --frames N          Frames per step (default 10)"
+            << std::endl
+            << "  --depth N           Steps from the start, at most 16 "
+               "(default 4)"
+            << std::endl
+            << "  --states N          Distinct states to keep track of at "
+               "most (default 1048576)"
+            << std::endl
+            << "  --threads N         Threads to search with (default one "
+               "per core)"
+            << std::endl
+            << "  --warmup N          Cycles to run without keys before the "
+               "search (default 0)"
+            << std::endl
+            << "  --seed N            Seed of the random numbers (default 0)"
+            << std::endl
+            << "  --pc ADDRESS        Stop at the first state with this "
+               "program counter, in hex,"
+            << std::endl
+            << "                      and print the keys that lead there"
+            << std::endl;
+}
+
+std::vector<Chip8::byte_t> load_program(const std::string &filepath)
+{
+  std::ifstream in(filepath, std::ios::in | std::ios::binary);
+  if (!in)
+  {
+    throw std::runtime_error("Could not open " + filepath);
+  }
+
+  return std::vector<Chip8::byte_t>((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char *argv[])
+{
+  Chip8::ExplorerOptions options;
+  uint64_t               warmup = 0;
+  uint64_t               seed   = 0;
+  int32_t                target = -1;
+  std::string            program_filepath;
+
+  try
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      const std::string arg = argv[i];
+
+      if (arg == "--frames" && i + 1 < argc)
+      {
+        options.frames = std::stoul(argv[++i]);
+      }
+      else if (arg == "--depth" && i + 1 < argc)
+      {
+        options.depth = std::stoul(argv[++i]);
+      }
+      else if (arg == "--states" && i + 1 < argc)
+      {
+        options.max_states = std::stoull(argv[++i]);
+      }
+      else if (arg == "--threads" && i + 1 < argc)
+      {
+        options.thread_count = std::stoul(argv[++i]);
+      }
+      else if (arg == "--warmup" && i + 1 < argc)
+      {
+        warmup = std::stoull(argv[++i]);
+      }
+      else if (arg == "--seed" && i + 1 < argc)
+      {
+        seed = std::stoull(argv[++i]);
+      }
+      else if (arg == "--pc" && i + 1 < argc)
+      {
+        target = std::stoul(argv[++i], nullptr, 16) & 0xFFF;
+      }
+      else if (program_filepath.empty() && arg.rfind("--", 0) != 0)
+      {
+        program_filepath = arg;
+      }
+      else
+      {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    }
+
+    if (program_filepath.empty())
+    {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+    Chip8::Cpu cpu(std::make_unique<Chip8::HeadlessKeyboard>());
+    cpu.init();
+    cpu.load_program(load_program(program_filepath));
+
+    Chip8::CpuState start = cpu.get_state();
+    start.random_engine.seed(seed);
+    cpu.set_state(start);
+    while (warmup > 0)
+    {
+      const auto batch = uint32_t(std::min<uint64_t>(warmup, 1 << 30));
+      cpu.run(batch);
+      warmup -= batch;
+    }
+    start = cpu.get_state();
+
+    std::mutex       found_mutex;
+    bool             found = false;
+    Chip8::InputPath found_path;
+
+    Chip8::Explorer::Visitor visitor;
+    if (target >= 0)
+    {
+      visitor = [&](const Chip8::CpuState &state,
+                    const Chip8::InputPath &path) {
+        if (Chip8::mask_address(state.pc_register) != uint32_t(target))
+        {
+          return Chip8::Explorer::Visit::Expand;
+        }
+
+        std::lock_guard<std::mutex> lock(found_mutex);
+        if (!found)
+        {
+          found      = true;
+          found_path = path;
+        }
+        return Chip8::Explorer::Visit::Stop;
+      };
+    }
+
+    Chip8::Explorer                 explorer(options);
+    const Chip8::ExplorerStatistics statistics = explorer.run(start, visitor);
+
+    std::printf("%llu states in %.3f s, %.0f states/s\n",
+                static_cast<unsigned long long>(statistics.states),
+                statistics.seconds, statistics.get_states_per_second());
+    std::printf("%llu distinct, %llu duplicates, deduplication ratio %.3f\n",
+                static_cast<unsigned long long>(statistics.unique),
+                static_cast<unsigned long long>(statistics.duplicates),
+                statistics.get_deduplication_ratio());
+    std::printf("%llu states stored with %.1f bytes each, %.0fx compressed, "
+                "frontier at most %zu bytes\n",
+                static_cast<unsigned long long>(statistics.stored_states),
+                statistics.stored_states
+                    ? double(statistics.stored_bytes) /
+                          statistics.stored_states
+                    : 0.0,
+                statistics.get_compression_ratio(),
+                statistics.peak_frontier_bytes);
+    std::printf("%llu states expanded again after a shorter path to them, "
+                "%llu steals, hash set of %zu bytes%s\n",
+                static_cast<unsigned long long>(statistics.revisits),
+                static_cast<unsigned long long>(statistics.steals),
+                statistics.hash_set_bytes,
+                statistics.truncated ? ", full before the search was done"
+                                     : "");
+
+    if (target >= 0)
+    {
+      if (!found)
+      {
+        std::printf("No state with pc 0x%03X found\n", target);
+        return EXIT_FAILURE;
+      }
+
+      std::printf("pc 0x%03X after keys", target);
+      for (uint32_t step = 0; step < found_path.length; ++step)
+      {
+        std::printf(" %X", found_path.get_key(step));
+      }
+      std::printf(", %u frames each\n", options.frames);
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "cpu.hpp"
+#include "headless_keyboard.hpp"
+
+namespace
+{
+
+using Chip8::byte_t;
+
+/**
+ * Cycles a single input may run. Keeps every execution short, so the
+ * fuzzer can try many inputs.
+ */
+constexpr uint32_t max_cycles = 2000;
+
+/**
+ * Bytes of a key event in the input.
+ */
+constexpr size_t key_event_size = 4;
+
+/**
+ * @brief A cpu that is built once and reset to a pristine state before
+ * every input.
+ *
+ * Constructing a cpu seeds from std::random_device and allocates, which
+ * would dominate the time of short runs. Resetting copies the saved state
+ * back, which is a single memcpy.
+ */
+class Harness
+{
+public:
+  Harness()
+  {
+    auto new_keyboard = std::make_unique<Chip8::HeadlessKeyboard>();
+    keyboard          = new_keyboard.get();
+    cpu               = std::make_unique<Chip8::Cpu>(std::move(new_keyboard));
+    cpu->init();
+
+    // Crashes have to reproduce, so the random numbers may not depend on
+    // the run
+    pristine = cpu->get_state();
+    pristine.random_engine.seed(1);
+  }
+
+  /**
+   * Run an input. Its layout is
+   *
+   *   1 byte       number of key events N
+   *   N * 4 bytes  key events: cycles to run before the event and the mask
+   *                of pressed keys, both 16 bit big endian
+   *   the rest     the program
+   */
+  void run(const uint8_t *data, size_t size)
+  {
+    if (size == 0)
+    {
+      return;
+    }
+
+    const size_t   key_event_count = data[0];
+    const uint8_t *key_events      = data + 1;
+    const size_t   key_bytes = std::min(key_event_count * key_event_size,
+                                        size - 1);
+
+    const uint8_t *program      = key_events + key_bytes;
+    const size_t   program_size = std::min<size_t>(
+        size - 1 - key_bytes, Chip8::memory_size - program_start);
+
+    cpu->set_state(pristine);
+    cpu->load_program(program, program_size);
+    keyboard->set_keys(0);
+
+    uint32_t cycles = max_cycles;
+
+    for (size_t i = 0; i + key_event_size <= key_bytes; i += key_event_size)
+    {
+      const uint32_t delay =
+          std::min<uint32_t>(key_events[i] << 8 | key_events[i + 1], cycles);
+
+      if (!run_cycles(delay))
+      {
+        return;
+      }
+      cycles -= delay;
+
+      keyboard->set_keys(key_events[i + 2] << 8 | key_events[i + 3]);
+    }
+
+    run_cycles(cycles);
+  }
+
+private:
+  static constexpr size_t program_start = 0x200;
+
+  std::unique_ptr<Chip8::Cpu> cpu{};
+  Chip8::HeadlessKeyboard    *keyboard{};
+  Chip8::CpuState             pristine{};
+
+  /**
+   * @return false if the cpu is paused, which it never leaves without
+   * input from the frontend
+   */
+  bool run_cycles(uint32_t cycles)
+  {
+    // Returns right away at a key wait instead of idling through the rest
+    cpu->run_until(cycles, Chip8::RunEvent::None);
+    return !cpu->is_paused();
+  }
+};
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  static Harness harness;
+  harness.run(data, size);
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/**
+ * Driver for builds without libFuzzer. Runs the inputs given on the
+ * command line, e.g. to reproduce a crash, or random inputs to measure the
+ * executions per second.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc > 1 && std::string(argv[1]).rfind("-", 0) != 0)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      std::ifstream in(argv[i], std::ios::in | std::ios::binary);
+      if (!in)
+      {
+        std::cerr << "Could not open " << argv[i] << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      const std::vector<uint8_t> input((std::istreambuf_iterator<char>(in)),
+                                       std::istreambuf_iterator<char>());
+      LLVMFuzzerTestOneInput(input.data(), input.size());
+      std::cout << argv[i] << ": ok" << std::endl;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  uint64_t runs = 100000;
+  if (argc > 1 && std::string(argv[1]).rfind("-runs=", 0) == 0)
+  {
+    runs = std::stoull(std::string(argv[1]).substr(6));
+  }
+
+  std::mt19937                            random(0);
+  std::uniform_int_distribution<uint32_t> byte(0, 255);
+  std::vector<uint8_t>                    input(512);
+
+  const auto start = std::chrono::steady_clock::now();
+
+  for (uint64_t run = 0; run < runs; ++run)
+  {
+    for (auto &value : input)
+    {
+      value = byte(random);
+    }
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+  }
+
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  std::cout << runs << " random inputs, " << runs / seconds << " exec/s"
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+/*
+ * The part of the libretro API (libretro.h from libretro-common, MIT
+ * licensed) that chip8_libretro and its test frontend use. The values and
+ * layouts are the ones of the upstream header, so a full libretro.h can
+ * replace this file.
+ */
+
+#ifndef LIBRETRO_H__
+#define LIBRETRO_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RETRO_API
+#define RETRO_API __attribute__((__visibility__("default")))
+#endif
+
+#define RETRO_API_VERSION 1
+
+#define RETRO_DEVICE_NONE     0
+#define RETRO_DEVICE_JOYPAD   1
+#define RETRO_DEVICE_KEYBOARD 3
+
+#define RETRO_DEVICE_ID_JOYPAD_B      0
+#define RETRO_DEVICE_ID_JOYPAD_Y      1
+#define RETRO_DEVICE_ID_JOYPAD_SELECT 2
+#define RETRO_DEVICE_ID_JOYPAD_START  3
+#define RETRO_DEVICE_ID_JOYPAD_UP     4
+#define RETRO_DEVICE_ID_JOYPAD_DOWN   5
+#define RETRO_DEVICE_ID_JOYPAD_LEFT   6
+#define RETRO_DEVICE_ID_JOYPAD_RIGHT  7
+#define RETRO_DEVICE_ID_JOYPAD_A      8
+#define RETRO_DEVICE_ID_JOYPAD_X      9
+#define RETRO_DEVICE_ID_JOYPAD_L      10
+#define RETRO_DEVICE_ID_JOYPAD_R      11
+
+#define RETRO_REGION_NTSC 0
+
+#define RETRO_MEMORY_SYSTEM_RAM 2
+
+#define RETRO_ENVIRONMENT_EXPERIMENTAL     0x10000
+#define RETRO_ENVIRONMENT_GET_CAN_DUPE     3
+#define RETRO_ENVIRONMENT_SET_PIXEL_FORMAT 10
+#define RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER                    \
+  (40 | RETRO_ENVIRONMENT_EXPERIMENTAL)
+
+#define RETRO_MEMORY_ACCESS_WRITE (1 << 0)
+#define RETRO_MEMORY_ACCESS_READ  (1 << 1)
+
+/* Keyboard keys are ASCII for digits and lower case letters */
+enum retro_key
+{
+  RETROK_0 = 48,
+  RETROK_1 = 49,
+  RETROK_2 = 50,
+  RETROK_3 = 51,
+  RETROK_4 = 52,
+  RETROK_a = 97,
+  RETROK_c = 99,
+  RETROK_d = 100,
+  RETROK_e = 101,
+  RETROK_f = 102,
+  RETROK_q = 113,
+  RETROK_r = 114,
+  RETROK_s = 115,
+  RETROK_v = 118,
+  RETROK_w = 119,
+  RETROK_x = 120,
+  RETROK_z = 122
+};
+
+enum retro_pixel_format
+{
+  RETRO_PIXEL_FORMAT_0RGB1555 = 0,
+  RETRO_PIXEL_FORMAT_XRGB8888 = 1,
+  RETRO_PIXEL_FORMAT_RGB565   = 2,
+  RETRO_PIXEL_FORMAT_UNKNOWN  = INT32_MAX
+};
+
+struct retro_framebuffer
+{
+  void                   *data;
+  unsigned                width;
+  unsigned                height;
+  size_t                  pitch;
+  enum retro_pixel_format format;
+  unsigned                access_flags;
+  unsigned                memory_flags;
+};
+
+struct retro_system_info
+{
+  const char *library_name;
+  const char *library_version;
+  const char *valid_extensions;
+  bool        need_fullpath;
+  bool        block_extract;
+};
+
+struct retro_game_geometry
+{
+  unsigned base_width;
+  unsigned base_height;
+  unsigned max_width;
+  unsigned max_height;
+  float    aspect_ratio;
+};
+
+struct retro_system_timing
+{
+  double fps;
+  double sample_rate;
+};
+
+struct retro_system_av_info
+{
+  struct retro_game_geometry geometry;
+  struct retro_system_timing timing;
+};
+
+struct retro_game_info
+{
+  const char *path;
+  const void *data;
+  size_t      size;
+  const char *meta;
+};
+
+typedef bool (*retro_environment_t)(unsigned cmd, void *data);
+typedef void (*retro_video_refresh_t)(const void *data,
+                                      unsigned    width,
+                                      unsigned    height,
+                                      size_t      pitch);
+typedef void (*retro_audio_sample_t)(int16_t left, int16_t right);
+typedef size_t (*retro_audio_sample_batch_t)(const int16_t *data,
+                                             size_t         frames);
+typedef void (*retro_input_poll_t)(void);
+typedef int16_t (*retro_input_state_t)(unsigned port,
+                                       unsigned device,
+                                       unsigned index,
+                                       unsigned id);
+
+RETRO_API void retro_set_environment(retro_environment_t);
+RETRO_API void retro_set_video_refresh(retro_video_refresh_t);
+RETRO_API void retro_set_audio_sample(retro_audio_sample_t);
+RETRO_API void retro_set_audio_sample_batch(retro_audio_sample_batch_t);
+RETRO_API void retro_set_input_poll(retro_input_poll_t);
+RETRO_API void retro_set_input_state(retro_input_state_t);
+
+RETRO_API void     retro_init(void);
+RETRO_API void     retro_deinit(void);
+RETRO_API unsigned retro_api_version(void);
+
+RETRO_API void retro_get_system_info(struct retro_system_info *info);
+RETRO_API void retro_get_system_av_info(struct retro_system_av_info *info);
+RETRO_API void retro_set_controller_port_device(unsigned port,
+                                                unsigned device);
+
+RETRO_API void retro_reset(void);
+RETRO_API void retro_run(void);
+
+RETRO_API size_t retro_serialize_size(void);
+RETRO_API bool   retro_serialize(void *data, size_t size);
+RETRO_API bool   retro_unserialize(const void *data, size_t size);
+
+RETRO_API void retro_cheat_reset(void);
+RETRO_API void retro_cheat_set(unsigned index, bool enabled, const char *code);
+
+RETRO_API bool retro_load_game(const struct retro_game_info *game);
+RETRO_API bool retro_load_game_special(unsigned                      game_type,
+                                       const struct retro_game_info *info,
+                                       size_t                        num_info);
+RETRO_API void retro_unload_game(void);
+
+RETRO_API unsigned retro_get_region(void);
+RETRO_API void    *retro_get_memory_data(unsigned id);
+RETRO_API size_t   retro_get_memory_size(unsigned id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,346 @@
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "cpu.hpp"
+#include "headless_keyboard.hpp"
+#include "libretro.h"
+
+namespace
+{
+
+using Chip8::byte_t;
+using Chip8::display_height;
+using Chip8::display_width;
+
+/**
+ * Same pace as the simulator, which runs one cycle per presented frame.
+ */
+constexpr uint32_t cycles_per_frame = 1;
+
+constexpr double frames_per_second = 60.0;
+
+constexpr uint32_t pixel_on  = 0x00FFFFFF;
+constexpr uint32_t pixel_off = 0x00000000;
+
+/**
+ * Keypad keys of the joypad buttons. The d-pad is laid out like on the
+ * keypad, around 5.
+ */
+constexpr std::array<std::pair<unsigned, uint8_t>, 10> joypad_keys = {{
+    {RETRO_DEVICE_ID_JOYPAD_UP, 0x2},
+    {RETRO_DEVICE_ID_JOYPAD_DOWN, 0x8},
+    {RETRO_DEVICE_ID_JOYPAD_LEFT, 0x4},
+    {RETRO_DEVICE_ID_JOYPAD_RIGHT, 0x6},
+    {RETRO_DEVICE_ID_JOYPAD_A, 0x5},
+    {RETRO_DEVICE_ID_JOYPAD_B, 0x0},
+    {RETRO_DEVICE_ID_JOYPAD_X, 0x1},
+    {RETRO_DEVICE_ID_JOYPAD_Y, 0x3},
+    {RETRO_DEVICE_ID_JOYPAD_L, 0x7},
+    {RETRO_DEVICE_ID_JOYPAD_R, 0x9},
+}};
+
+/**
+ * Keyboard keys of the keypad keys 0 to F, with the keypad on the left of
+ * a QWERTY keyboard.
+ */
+constexpr std::array<unsigned, 16> keyboard_keys = {
+    RETROK_x, RETROK_1, RETROK_2, RETROK_3, RETROK_q, RETROK_w,
+    RETROK_e, RETROK_a, RETROK_s, RETROK_d, RETROK_z, RETROK_c,
+    RETROK_4, RETROK_r, RETROK_f, RETROK_v};
+
+retro_environment_t environment{};
+retro_video_refresh_t video_refresh{};
+retro_input_poll_t    input_poll{};
+retro_input_state_t   input_state{};
+
+std::unique_ptr<Chip8::Cpu> cpu{};
+Chip8::HeadlessKeyboard    *keyboard{};
+
+/**
+ * State right after loading the game, restored by retro_reset().
+ */
+Chip8::CpuState loaded_state{};
+
+/**
+ * Start of a save state, followed by the bytes of the CpuState. States of
+ * other builds are refused, since the layout of CpuState may differ.
+ */
+struct SaveStateHeader
+{
+  char     magic[8]   = {'C', 'H', 'I', 'P', '8', 'S', 'A', 'V'};
+  uint32_t version    = 1;
+  uint32_t state_size = sizeof(Chip8::CpuState);
+
+  bool is_compatible() const
+  {
+    const SaveStateHeader current;
+    return std::memcmp(magic, current.magic, sizeof(magic)) == 0 &&
+           version == current.version && state_size == current.state_size;
+  }
+};
+
+constexpr size_t save_state_size =
+    sizeof(SaveStateHeader) + sizeof(Chip8::CpuState);
+
+/**
+ * Used if the frontend does not provide a buffer to draw into.
+ */
+std::array<uint32_t, display_width * display_height> video_buffer{};
+
+/**
+ * Framebuffer of the last frame handed to the frontend.
+ */
+Chip8::Framebuffer presented{};
+bool               presented_once = false;
+
+uint16_t read_keys()
+{
+  uint16_t keys = 0;
+
+  for (const auto &entry : joypad_keys)
+  {
+    if (input_state(0, RETRO_DEVICE_JOYPAD, 0, entry.first))
+    {
+      keys |= 1 << entry.second;
+    }
+  }
+
+  for (uint32_t key = 0; key < keyboard_keys.size(); ++key)
+  {
+    if (input_state(0, RETRO_DEVICE_KEYBOARD, 0, keyboard_keys[key]))
+    {
+      keys |= 1 << key;
+    }
+  }
+
+  return keys;
+}
+
+void present()
+{
+  const Chip8::Framebuffer &framebuffer = cpu->get_framebuffer();
+
+  // Most frames do not draw. Let the frontend show the last one again.
+  bool can_dupe = false;
+  if (presented_once && framebuffer == presented &&
+      environment(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe) && can_dupe)
+  {
+    video_refresh(nullptr, display_width, display_height,
+                  display_width * sizeof(uint32_t));
+    return;
+  }
+  presented      = framebuffer;
+  presented_once = true;
+
+  // Draw straight into memory of the frontend if it offers some
+  retro_framebuffer target{};
+  target.width        = display_width;
+  target.height       = display_height;
+  target.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+
+  uint8_t *pixels = reinterpret_cast<uint8_t *>(video_buffer.data());
+  size_t   pitch  = display_width * sizeof(uint32_t);
+
+  if (environment(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER,
+                  &target) &&
+      target.data && target.format == RETRO_PIXEL_FORMAT_XRGB8888 &&
+      target.width == display_width && target.height == display_height)
+  {
+    pixels = static_cast<uint8_t *>(target.data);
+    pitch  = target.pitch;
+  }
+
+  for (uint32_t y = 0; y < display_height; ++y)
+  {
+    auto *row = reinterpret_cast<uint32_t *>(pixels + y * pitch);
+    for (uint32_t x = 0; x < display_width; ++x)
+    {
+      row[x] = framebuffer[y][x] ? pixel_on : pixel_off;
+    }
+  }
+
+  video_refresh(pixels, display_width, display_height, pitch);
+}
+
+} // namespace
+
+void retro_set_environment(retro_environment_t callback)
+{
+  environment = callback;
+}
+
+void retro_set_video_refresh(retro_video_refresh_t callback)
+{
+  video_refresh = callback;
+}
+
+// The chip8 sound timer only drives a buzzer, which is not emulated
+void retro_set_audio_sample(retro_audio_sample_t) {}
+
+void retro_set_audio_sample_batch(retro_audio_sample_batch_t) {}
+
+void retro_set_input_poll(retro_input_poll_t callback)
+{
+  input_poll = callback;
+}
+
+void retro_set_input_state(retro_input_state_t callback)
+{
+  input_state = callback;
+}
+
+void retro_init() {}
+
+void retro_deinit() { cpu.reset(); }
+
+unsigned retro_api_version() { return RETRO_API_VERSION; }
+
+void retro_get_system_info(retro_system_info *info)
+{
+  std::memset(info, 0, sizeof(*info));
+  info->library_name     = "chip8";
+  info->library_version  = "0.0.1";
+  info->valid_extensions = "ch8|c8|bin";
+  info->need_fullpath    = false;
+  info->block_extract    = false;
+}
+
+void retro_get_system_av_info(retro_system_av_info *info)
+{
+  std::memset(info, 0, sizeof(*info));
+  info->geometry.base_width   = display_width;
+  info->geometry.base_height  = display_height;
+  info->geometry.max_width    = display_width;
+  info->geometry.max_height   = display_height;
+  info->geometry.aspect_ratio = float(display_width) / display_height;
+  info->timing.fps            = frames_per_second;
+  info->timing.sample_rate    = 0.0;
+}
+
+void retro_set_controller_port_device(unsigned /*port*/, unsigned /*device*/)
+{
+}
+
+void retro_reset()
+{
+  if (cpu)
+  {
+    cpu->set_state(loaded_state);
+    presented_once = false;
+  }
+}
+
+void retro_run()
+{
+  input_poll();
+  keyboard->set_keys(read_keys());
+
+  cpu->run(cycles_per_frame);
+
+  present();
+}
+
+size_t retro_serialize_size() { return save_state_size; }
+
+bool retro_serialize(void *data, size_t size)
+{
+  if (!cpu || size < save_state_size)
+  {
+    return false;
+  }
+
+  const SaveStateHeader header;
+  auto *bytes = static_cast<uint8_t *>(data);
+  std::memcpy(bytes, &header, sizeof(header));
+  std::memcpy(bytes + sizeof(header), &cpu->get_state(),
+              sizeof(Chip8::CpuState));
+  return true;
+}
+
+bool retro_unserialize(const void *data, size_t size)
+{
+  if (!cpu || size < save_state_size)
+  {
+    return false;
+  }
+
+  const auto     *bytes = static_cast<const uint8_t *>(data);
+  SaveStateHeader header;
+  std::memcpy(&header, bytes, sizeof(header));
+  if (!header.is_compatible())
+  {
+    return false;
+  }
+
+  const uint8_t  *state_bytes = bytes + sizeof(header);
+  Chip8::CpuState state;
+  std::memcpy(&state, state_bytes, sizeof(state));
+
+  // A corrupt state may hold any byte where the bool is, which must not be
+  // read as a bool. The guard is refreshed the same way.
+  state.paused = state_bytes[offsetof(Chip8::CpuState, paused)] != 0;
+  Chip8::update_memory_guard(state.memory);
+
+  cpu->set_state(state);
+
+  presented_once = false;
+  return true;
+}
+
+void retro_cheat_reset() {}
+
+void retro_cheat_set(unsigned /*index*/, bool /*enabled*/, const char *)
+{
+}
+
+bool retro_load_game(const retro_game_info *game)
+{
+  if (!game || !game->data)
+  {
+    return false;
+  }
+
+  auto format = RETRO_PIXEL_FORMAT_XRGB8888;
+  if (!environment(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &format))
+  {
+    return false;
+  }
+
+  auto  new_keyboard = std::make_unique<Chip8::HeadlessKeyboard>();
+  auto *keys         = new_keyboard.get();
+  auto  new_cpu      = std::make_unique<Chip8::Cpu>(std::move(new_keyboard));
+
+  try
+  {
+    new_cpu->init();
+    new_cpu->load_program(static_cast<const byte_t *>(game->data),
+                          game->size);
+  }
+  catch (const std::exception &)
+  {
+    return false;
+  }
+
+  cpu            = std::move(new_cpu);
+  keyboard       = keys;
+  loaded_state   = cpu->get_state();
+  presented_once = false;
+
+  return true;
+}
+
+void retro_unload_game() { cpu.reset(); }
+
+bool retro_load_game_special(unsigned, const retro_game_info *, size_t)
+{
+  return false;
+}
+
+unsigned retro_get_region() { return RETRO_REGION_NTSC; }
+
+void *retro_get_memory_data(unsigned /*id*/) { return nullptr; }
+
+size_t retro_get_memory_size(unsigned /*id*/) { return 0; }
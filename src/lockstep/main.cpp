@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "aot_engine.hpp"
+#include "aot_module.hpp"
+#include "fusion_engine.hpp"
+#include "key_script.hpp"
+#include "lockstep.hpp"
+
+void print_usage(const char *program_name)
+{
+  std::cerr << "Usage: " << program_name
+            << " [OPTIONS] PROGRAM_FILEPATH..." << std::endl
+            << std::endl
+            << "Run programs on the interpreter and on an engine side by side "
+               "and report the"
+            << std::endl
+            << "first instruction after which their states differ." << std::endl
+            << std::endl
+            << "Options:" << std::endl
+            << "  --fusion            Check the fusion engine (default)"
+            << std::endl
+            << "  --aot FILEPATH      Check a module recompiled by chip8_aot"
+            << std::endl
+            << "  --cycles N          Cycles to run per program (default "
+               "1000000)"
+            << std::endl
+            << "  --step N            Compare every N cycles instead of after "
+               "every block"
+            << std::endl
+            << "                      of the engine or interpreted "
+               "instruction"
+            << std::endl
+            << "  --keys FILEPATH     Key script with lines of "
+               "\"CYCLE KEY_MASK\", the mask"
+            << std::endl
+            << "                      in hex with bit N for key N" << std::endl;
+}
+
+std::vector<Chip8::byte_t> load_program(const std::string &filepath)
+{
+  std::ifstream in(filepath, std::ios::in | std::ios::binary);
+  if (!in)
+  {
+    throw std::runtime_error("Could not open " + filepath);
+  }
+
+  return std::vector<Chip8::byte_t>((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char *argv[])
+{
+  std::string              aot_filepath;
+  std::string              keys_filepath;
+  uint64_t                 cycles = 1000000;
+  uint32_t                 step   = 1;
+  std::vector<std::string> program_filepaths;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+
+    if (arg == "--fusion")
+    {
+      aot_filepath.clear();
+    }
+    else if (arg == "--aot" && i + 1 < argc)
+    {
+      aot_filepath = argv[++i];
+    }
+    else if (arg == "--cycles" && i + 1 < argc)
+    {
+      cycles = std::stoull(argv[++i]);
+    }
+    else if (arg == "--step" && i + 1 < argc)
+    {
+      step = std::max(1ul, std::stoul(argv[++i]));
+    }
+    else if (arg == "--keys" && i + 1 < argc)
+    {
+      keys_filepath = argv[++i];
+    }
+    else if (arg.rfind("--", 0) != 0)
+    {
+      program_filepaths.push_back(arg);
+    }
+    else
+    {
+      print_usage(argv[0]);
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if (program_filepaths.empty())
+  {
+    print_usage(argv[0]);
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::vector<Chip8::KeyEvent> key_script;
+  if (!keys_filepath.empty())
+  {
+    try
+    {
+      key_script = Chip8::load_key_script(keys_filepath);
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << e.what() << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  bool failed = false;
+
+  for (const auto &filepath : program_filepaths)
+  {
+    try
+    {
+      const auto program = load_program(filepath);
+
+      Chip8::Lockstep lockstep(program, key_script);
+      Chip8::Cpu     &candidate = lockstep.get_candidate();
+
+      if (aot_filepath.empty())
+      {
+        candidate.set_engine(std::make_unique<Chip8::FusionEngine>());
+      }
+      else
+      {
+        const auto &module = Chip8::load_aot_module(aot_filepath);
+        candidate.set_engine(
+            std::make_unique<Chip8::AotEngine>(module, candidate));
+      }
+
+      const auto start  = std::chrono::steady_clock::now();
+      const bool same   = lockstep.run(cycles, step);
+      const auto finish = std::chrono::steady_clock::now();
+
+      const double seconds = std::chrono::duration<double>(finish - start)
+                                 .count();
+
+      if (same)
+      {
+        std::cout << filepath << ": ok, " << lockstep.get_cycle()
+                  << " cycles, "
+                  << lockstep.get_cycle() / seconds / 1000000.0
+                  << " Mcycles/s";
+        if (step == 1 && lockstep.get_cycle() > 0)
+        {
+          std::cout << ", " << lockstep.get_block_cycles() * 100.0 /
+                                   lockstep.get_cycle()
+                    << "% in blocks of the engine";
+        }
+        std::cout << std::endl;
+      }
+      else
+      {
+        std::cout << filepath << ": diverged" << std::endl
+                  << lockstep.get_report();
+        failed = true;
+      }
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << filepath << ": " << e.what() << std::endl;
+      failed = true;
+    }
+  }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
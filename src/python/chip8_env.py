@@ -0,0 +1,178 @@
+"""Vectorized CHIP-8 environments for reinforcement learning.
+
+Wraps the chip8_vec_env shared library with ctypes. The library is looked
+up next to this file unless CHIP8_VEC_ENV_LIBRARY names it. Calls into the
+library release the GIL.
+
+    env = VecEnv(open("game.bin", "rb").read(), num_envs=256)
+    observations = env.reset()
+    observations = env.step(actions)  # uint16 key masks, bit n is key n
+
+Observations are a (num_envs, 32, 64) uint8 NumPy view over the
+framebuffers of the machines, 1 for lit pixels. They are not copied, so
+they change with the next step or reset. The machines are freed when the
+environment is closed and no observation array is left.
+"""
+
+import ctypes
+import operator
+import os
+
+import numpy as np
+
+DISPLAY_HEIGHT = 32
+DISPLAY_WIDTH = 64
+
+
+def _load_library():
+    path = os.environ.get("CHIP8_VEC_ENV_LIBRARY") or os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "libchip8_vec_env.so"
+    )
+    library = ctypes.CDLL(path)
+
+    env_p = ctypes.c_void_p
+    signatures = {
+        "chip8_vec_env_create": (
+            env_p,
+            [
+                ctypes.c_char_p,
+                ctypes.c_size_t,
+                ctypes.c_uint32,
+                ctypes.c_uint32,
+                ctypes.c_uint32,
+                ctypes.c_uint64,
+            ],
+        ),
+        "chip8_vec_env_error": (ctypes.c_char_p, []),
+        "chip8_vec_env_destroy": (None, [env_p]),
+        "chip8_vec_env_step": (None, [env_p, ctypes.c_void_p]),
+        "chip8_vec_env_reset": (ctypes.c_int, [env_p, ctypes.c_uint32]),
+        "chip8_vec_env_reset_all": (None, [env_p]),
+        "chip8_vec_env_size": (ctypes.c_uint32, [env_p]),
+        "chip8_vec_env_thread_count": (ctypes.c_uint32, [env_p]),
+        "chip8_vec_env_framebuffers": (ctypes.c_void_p, [env_p]),
+        "chip8_vec_env_framebuffer_stride": (ctypes.c_size_t, [env_p]),
+        "chip8_vec_env_memory_usage": (ctypes.c_size_t, [env_p]),
+    }
+    for name, (restype, argtypes) in signatures.items():
+        function = getattr(library, name)
+        function.restype = restype
+        function.argtypes = argtypes
+
+    return library
+
+
+_library = None
+
+
+class _Machines:
+    """Owns the native environment and destroys it with the last reference.
+
+    Observation arrays reference it through their buffer, so they stay
+    valid after VecEnv.close().
+    """
+
+    def __init__(self, library, env):
+        self._library = library
+        self.env = env
+
+    def __del__(self):
+        self._library.chip8_vec_env_destroy(self.env)
+
+
+class VecEnv:
+    """num_envs machines running the same program, stepped in parallel.
+
+    Every step runs cycles_per_frame cycles on each machine, spread over
+    num_threads threads (0 for one per core). Machine n draws random
+    numbers seeded with seed + n.
+    """
+
+    def __init__(self, program, num_envs, cycles_per_frame=1, num_threads=0,
+                 seed=0):
+        global _library
+        if _library is None:
+            _library = _load_library()
+        self._library = _library
+
+        self._env = None
+        if num_envs <= 0:
+            raise ValueError("num_envs must be positive")
+
+        program = bytes(program)
+        env = self._library.chip8_vec_env_create(
+            program, len(program), num_envs, cycles_per_frame, num_threads,
+            seed)
+        if not env:
+            raise RuntimeError(self._library.chip8_vec_env_error().decode())
+        self._machines = _Machines(self._library, env)
+        self._env = env
+
+        self.num_envs = num_envs
+        self.num_threads = self._library.chip8_vec_env_thread_count(self._env)
+
+        # A strided view straight into the machines, no copy involved
+        stride = self._library.chip8_vec_env_framebuffer_stride(self._env)
+        address = self._library.chip8_vec_env_framebuffers(self._env)
+        size = stride * (num_envs - 1) + DISPLAY_HEIGHT * DISPLAY_WIDTH
+        buffer = (ctypes.c_uint8 * size).from_address(address)
+        buffer.machines = self._machines
+
+        self.observations = np.ndarray(
+            shape=(num_envs, DISPLAY_HEIGHT, DISPLAY_WIDTH),
+            dtype=np.uint8,
+            buffer=buffer,
+            strides=(stride, DISPLAY_WIDTH, 1),
+        )
+        self.observations.flags.writeable = False
+
+        self._actions = np.zeros(num_envs, dtype=np.uint16)
+
+    def step(self, actions):
+        """Press the keys in actions and run one frame on every machine."""
+        self._check_open()
+        actions = np.ascontiguousarray(actions, dtype=np.uint16)
+        if actions.shape != (self.num_envs,):
+            raise ValueError("Expected one key mask per environment")
+        self._library.chip8_vec_env_step(self._env, actions.ctypes.data)
+        return self.observations
+
+    def reset(self, index=None):
+        """Reset one machine, or all of them if index is None."""
+        self._check_open()
+        if index is None:
+            self._library.chip8_vec_env_reset_all(self._env)
+            return self.observations
+
+        # No wrap around for negative indices, a -1 is most likely a bug
+        index = operator.index(index)
+        if not 0 <= index < self.num_envs:
+            raise IndexError(
+                f"Environment {index} out of range for {self.num_envs}")
+        self._library.chip8_vec_env_reset(self._env, index)
+        return self.observations
+
+    def memory_usage(self):
+        """Bytes used by the machines, including the memory they share."""
+        self._check_open()
+        return self._library.chip8_vec_env_memory_usage(self._env)
+
+    def close(self):
+        """Give up the machines. Observations returned before stay valid."""
+        if self._env:
+            self.observations = None
+            self._machines = None
+            self._env = None
+
+    def _check_open(self):
+        if not self._env:
+            raise ValueError("The environment is closed")
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exception):
+        self.close()
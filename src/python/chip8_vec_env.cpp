@@ -0,0 +1,84 @@
+#include <exception>
+#include <string>
+
+#include "chip8_vec_env.h"
+#include "vec_env.hpp"
+
+struct chip8_vec_env
+{
+  Chip8::VecEnv env;
+};
+
+namespace
+{
+
+thread_local std::string error;
+
+} // namespace
+
+chip8_vec_env *chip8_vec_env_create(const uint8_t *program,
+                                    size_t         program_size,
+                                    uint32_t       count,
+                                    uint32_t       cycles_per_frame,
+                                    uint32_t       thread_count,
+                                    uint64_t       seed)
+{
+  try
+  {
+    return new chip8_vec_env{
+        {std::vector<Chip8::byte_t>(program, program + program_size), count,
+         cycles_per_frame, thread_count, seed}};
+  }
+  catch (const std::exception &e)
+  {
+    error = e.what();
+    return nullptr;
+  }
+}
+
+const char *chip8_vec_env_error() { return error.c_str(); }
+
+void chip8_vec_env_destroy(chip8_vec_env *env) { delete env; }
+
+void chip8_vec_env_step(chip8_vec_env *env, const uint16_t *actions)
+{
+  env->env.step(actions);
+}
+
+int chip8_vec_env_reset(chip8_vec_env *env, uint32_t index)
+{
+  if (index >= env->env.size())
+  {
+    return -1;
+  }
+
+  env->env.reset(index);
+  return 0;
+}
+
+void chip8_vec_env_reset_all(chip8_vec_env *env) { env->env.reset(); }
+
+uint32_t chip8_vec_env_size(const chip8_vec_env *env)
+{
+  return env->env.size();
+}
+
+uint32_t chip8_vec_env_thread_count(const chip8_vec_env *env)
+{
+  return env->env.get_thread_count();
+}
+
+const uint8_t *chip8_vec_env_framebuffers(const chip8_vec_env *env)
+{
+  return env->env.get_framebuffers();
+}
+
+size_t chip8_vec_env_framebuffer_stride(const chip8_vec_env *env)
+{
+  return env->env.get_framebuffer_stride();
+}
+
+size_t chip8_vec_env_memory_usage(const chip8_vec_env *env)
+{
+  return env->env.get_memory_usage();
+}
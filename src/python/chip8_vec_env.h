@@ -0,0 +1,71 @@
+#ifndef CHIP8_VEC_ENV_H
+#define CHIP8_VEC_ENV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * C interface of Chip8::VecEnv, for loading with ctypes or other foreign
+ * function interfaces.
+ */
+typedef struct chip8_vec_env chip8_vec_env;
+
+/**
+ * @return NULL on failure, see chip8_vec_env_error()
+ */
+chip8_vec_env *chip8_vec_env_create(const uint8_t *program,
+                                    size_t         program_size,
+                                    uint32_t       count,
+                                    uint32_t       cycles_per_frame,
+                                    uint32_t       thread_count,
+                                    uint64_t       seed);
+
+/**
+ * Message of the last failed chip8_vec_env_create() of the calling thread.
+ */
+const char *chip8_vec_env_error(void);
+
+void chip8_vec_env_destroy(chip8_vec_env *env);
+
+/**
+ * @param actions One key mask per instance
+ */
+void chip8_vec_env_step(chip8_vec_env *env, const uint16_t *actions);
+
+/**
+ * Reset one instance.
+ *
+ * @return 0, or -1 without resetting anything if index is not below the
+ *         instance count
+ */
+int chip8_vec_env_reset(chip8_vec_env *env, uint32_t index);
+
+void chip8_vec_env_reset_all(chip8_vec_env *env);
+
+uint32_t chip8_vec_env_size(const chip8_vec_env *env);
+
+uint32_t chip8_vec_env_thread_count(const chip8_vec_env *env);
+
+/**
+ * Framebuffers of all instances. Each is 32 rows of 64 bytes, 0 or 1 per
+ * pixel, and the one of instance n starts n * stride bytes after the first.
+ * They stay valid until the environment is destroyed.
+ */
+const uint8_t *chip8_vec_env_framebuffers(const chip8_vec_env *env);
+
+size_t chip8_vec_env_framebuffer_stride(const chip8_vec_env *env);
+
+/**
+ * Bytes used by the instances, including the memory they share.
+ */
+size_t chip8_vec_env_memory_usage(const chip8_vec_env *env);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
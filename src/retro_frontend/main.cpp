@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "libretro.h"
+
+/**
+ * Minimal libretro frontend. Loads a core like a real frontend does, runs a
+ * program headless and checks that save states restore exactly.
+ */
+
+namespace
+{
+
+struct Core
+{
+  void *library{};
+
+  decltype(&retro_set_environment)    set_environment{};
+  decltype(&retro_set_video_refresh)  set_video_refresh{};
+  decltype(&retro_set_input_poll)     set_input_poll{};
+  decltype(&retro_set_input_state)    set_input_state{};
+  decltype(&retro_init)               init{};
+  decltype(&retro_deinit)             deinit{};
+  decltype(&retro_api_version)        api_version{};
+  decltype(&retro_get_system_av_info) get_system_av_info{};
+  decltype(&retro_load_game)          load_game{};
+  decltype(&retro_unload_game)        unload_game{};
+  decltype(&retro_run)                run{};
+  decltype(&retro_serialize_size)     serialize_size{};
+  decltype(&retro_serialize)          serialize{};
+  decltype(&retro_unserialize)        unserialize{};
+};
+
+template <typename Function>
+void resolve(Core &core, Function &function, const char *name)
+{
+  function = reinterpret_cast<Function>(dlsym(core.library, name));
+  if (!function)
+  {
+    std::cerr << "Core lacks " << name << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * Memory the core may draw into, like frontends that upload straight from
+ * a mapped texture.
+ */
+std::vector<uint32_t> frontend_buffer;
+unsigned              frontend_width  = 0;
+unsigned              frontend_height = 0;
+
+/**
+ * FNV-1a over all frames shown while hashing is on, to compare runs. Off
+ * while timing, so that only the core gets measured.
+ */
+bool     hashing    = false;
+uint64_t video_hash = 14695981039346656037ull;
+
+std::vector<uint8_t> last_frame;
+
+uint64_t frames_drawn    = 0;
+uint64_t frames_in_place = 0;
+uint64_t frames_duped    = 0;
+
+uint16_t pressed_buttons = 0;
+
+bool environment(unsigned command, void *data)
+{
+  switch (command)
+  {
+  case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+    *static_cast<bool *>(data) = true;
+    return true;
+
+  case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+    return *static_cast<retro_pixel_format *>(data) ==
+           RETRO_PIXEL_FORMAT_XRGB8888;
+
+  case RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER:
+  {
+    auto *target = static_cast<retro_framebuffer *>(data);
+    if (target->width != frontend_width || target->height != frontend_height)
+    {
+      return false;
+    }
+    target->data   = frontend_buffer.data();
+    target->pitch  = frontend_width * sizeof(uint32_t);
+    target->format = RETRO_PIXEL_FORMAT_XRGB8888;
+    return true;
+  }
+
+  default:
+    return false;
+  }
+}
+
+void video_refresh(const void *data,
+                   unsigned    width,
+                   unsigned    height,
+                   size_t      pitch)
+{
+  if (data)
+  {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+
+    last_frame.clear();
+    for (unsigned y = 0; y < height; ++y)
+    {
+      last_frame.insert(last_frame.end(), bytes + y * pitch,
+                        bytes + y * pitch + width * sizeof(uint32_t));
+    }
+
+    ++frames_drawn;
+    if (data == frontend_buffer.data())
+    {
+      ++frames_in_place;
+    }
+  }
+  else
+  {
+    ++frames_duped;
+  }
+
+  if (!hashing)
+  {
+    return;
+  }
+  for (const auto byte : last_frame)
+  {
+    video_hash ^= byte;
+    video_hash *= 1099511628211ull;
+  }
+}
+
+void input_poll() {}
+
+int16_t input_state(unsigned port, unsigned device, unsigned, unsigned id)
+{
+  return port == 0 && device == RETRO_DEVICE_JOYPAD && id < 16 &&
+         (pressed_buttons >> id) & 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3 || argc > 4)
+  {
+    std::cerr << "Usage: " << argv[0] << " CORE_FILEPATH PROGRAM_FILEPATH "
+              << "[FRAMES]" << std::endl
+              << std::endl
+              << "Run a program headless on a libretro core, report the time "
+                 "per frame and"
+              << std::endl
+              << "check that save states restore exactly." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const uint64_t frames = argc == 4 ? std::stoull(argv[3]) : 100000;
+
+  Core core;
+  core.library = dlopen(argv[1], RTLD_NOW | RTLD_LOCAL);
+  if (!core.library)
+  {
+    std::cerr << "Could not load " << dlerror() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  resolve(core, core.set_environment, "retro_set_environment");
+  resolve(core, core.set_video_refresh, "retro_set_video_refresh");
+  resolve(core, core.set_input_poll, "retro_set_input_poll");
+  resolve(core, core.set_input_state, "retro_set_input_state");
+  resolve(core, core.init, "retro_init");
+  resolve(core, core.deinit, "retro_deinit");
+  resolve(core, core.api_version, "retro_api_version");
+  resolve(core, core.get_system_av_info, "retro_get_system_av_info");
+  resolve(core, core.load_game, "retro_load_game");
+  resolve(core, core.unload_game, "retro_unload_game");
+  resolve(core, core.run, "retro_run");
+  resolve(core, core.serialize_size, "retro_serialize_size");
+  resolve(core, core.serialize, "retro_serialize");
+  resolve(core, core.unserialize, "retro_unserialize");
+
+  if (core.api_version() != RETRO_API_VERSION)
+  {
+    std::cerr << "Unsupported API version" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  core.set_environment(environment);
+  core.set_video_refresh(video_refresh);
+  core.set_input_poll(input_poll);
+  core.set_input_state(input_state);
+  core.init();
+
+  std::ifstream in(argv[2], std::ios::in | std::ios::binary);
+  if (!in)
+  {
+    std::cerr << "Could not open " << argv[2] << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::vector<char> program((std::istreambuf_iterator<char>(in)),
+                                  std::istreambuf_iterator<char>());
+
+  retro_game_info game{argv[2], program.data(), program.size(), nullptr};
+  if (!core.load_game(&game))
+  {
+    std::cerr << "The core could not load " << argv[2] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  retro_system_av_info av_info{};
+  core.get_system_av_info(&av_info);
+  frontend_width  = av_info.geometry.base_width;
+  frontend_height = av_info.geometry.base_height;
+  frontend_buffer.resize(frontend_width * frontend_height);
+
+  // Press a different button every second, so input paths run too
+  const auto run_frame = [&core](uint64_t frame) {
+    pressed_buttons = 1 << (frame / 60 % 12);
+    core.run();
+  };
+
+  double max_time = 0.0;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t frame = 0; frame < frames; ++frame)
+  {
+    const auto frame_start = std::chrono::steady_clock::now();
+    run_frame(frame);
+    const auto frame_end = std::chrono::steady_clock::now();
+
+    max_time = std::max(
+        max_time, std::chrono::duration<double>(frame_end - frame_start)
+                      .count());
+  }
+  const double time =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  std::cout << frames << " frames, " << time / frames * 1e9
+            << " ns per frame on average, " << max_time * 1e9 << " ns max"
+            << std::endl
+            << frames_drawn << " drawn (" << frames_in_place
+            << " into the frontend buffer), " << frames_duped << " duped"
+            << std::endl;
+
+  // Run on from a save state twice, the output has to be the same
+  std::vector<uint8_t> state(core.serialize_size());
+  if (!core.serialize(state.data(), state.size()))
+  {
+    std::cerr << "Serializing failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // States that are cut short or of some other core have to be refused
+  std::vector<uint8_t> damaged = state;
+  damaged[0] ^= 0xFF;
+  if (core.unserialize(damaged.data(), damaged.size()) ||
+      core.unserialize(state.data(), state.size() - 1))
+  {
+    std::cerr << "A damaged save state got loaded" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  hashing = true;
+
+  std::array<uint64_t, 2> hashes{};
+  for (auto &hash : hashes)
+  {
+    if (!core.unserialize(state.data(), state.size()))
+    {
+      std::cerr << "Unserializing failed" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    video_hash = 14695981039346656037ull;
+    for (uint64_t frame = 0; frame < 600; ++frame)
+    {
+      run_frame(frame);
+    }
+    hash = video_hash;
+  }
+
+  core.unload_game();
+  core.deinit();
+
+  if (hashes[0] != hashes[1])
+  {
+    std::cerr << "Save state did not restore the same machine" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Save state of " << state.size() << " bytes restores exactly"
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "key_script.hpp"
+#include "run_cache.hpp"
+
+void print_usage(const char *program_name)
+{
+  std::cerr << "Usage: " << program_name << " [OPTIONS] PROGRAM_FILEPATH"
+            << std::endl
+            << std::endl
+            << "Run a program headless and print the hash of the final state. "
+               "Results and"
+            << std::endl
+            << "checkpoints are cached, so repeated runs and runs that share a "
+               "prefix skip"
+            << std::endl
+            << "the cycles that were run before." << std::endl
+            << std::endl
+            << "Options:" << std::endl
+            << "  --cycles N          Cycles to run (default 1000000)"
+            << std::endl
+            << "  --keys FILEPATH     Key script with lines of "
+               "\"CYCLE KEY_MASK\", the mask"
+            << std::endl
+            << "                      in hex with bit N for key N" << std::endl
+            << "  --seed N            Seed of the random numbers (default 0)"
+            << std::endl
+            << "  --cache DIRECTORY   Where to cache states (default "
+               "$XDG_CACHE_HOME/chip8/runs)"
+            << std::endl
+            << "  --checkpoints N     Cache a checkpoint every N cycles "
+               "(default 100000)"
+            << std::endl
+            << "  --frame FILEPATH    Write the final framebuffer as PBM image"
+            << std::endl;
+}
+
+std::vector<Chip8::byte_t> load_program(const std::string &filepath)
+{
+  std::ifstream in(filepath, std::ios::in | std::ios::binary);
+  if (!in)
+  {
+    throw std::runtime_error("Could not open " + filepath);
+  }
+
+  return std::vector<Chip8::byte_t>((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+}
+
+std::string get_default_cache_directory()
+{
+  if (const char *cache_home = std::getenv("XDG_CACHE_HOME"))
+  {
+    return std::string(cache_home) + "/chip8/runs";
+  }
+  if (const char *home = std::getenv("HOME"))
+  {
+    return std::string(home) + "/.cache/chip8/runs";
+  }
+  return "chip8_runs";
+}
+
+void write_frame(const std::string &filepath, const Chip8::Framebuffer &frame)
+{
+  std::ofstream out(filepath, std::ios::out | std::ios::trunc);
+  if (!out)
+  {
+    throw std::runtime_error("Could not open " + filepath);
+  }
+
+  out << "P1\n" << Chip8::display_width << " " << Chip8::display_height
+      << "\n";
+  for (const auto &row : frame)
+  {
+    for (const auto pixel : row)
+    {
+      out << (pixel ? '1' : '0');
+    }
+    out << "\n";
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  uint64_t    cycles              = 1000000;
+  uint64_t    checkpoint_interval = 100000;
+  std::string keys_filepath;
+  std::string cache_directory = get_default_cache_directory();
+  std::string frame_filepath;
+  std::string program_filepath;
+
+  Chip8::RunInput input;
+
+  try
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      const std::string arg = argv[i];
+
+      if (arg == "--cycles" && i + 1 < argc)
+      {
+        cycles = std::stoull(argv[++i]);
+      }
+      else if (arg == "--keys" && i + 1 < argc)
+      {
+        keys_filepath = argv[++i];
+      }
+      else if (arg == "--seed" && i + 1 < argc)
+      {
+        input.seed = std::stoull(argv[++i]);
+      }
+      else if (arg == "--cache" && i + 1 < argc)
+      {
+        cache_directory = argv[++i];
+      }
+      else if (arg == "--checkpoints" && i + 1 < argc)
+      {
+        checkpoint_interval = std::stoull(argv[++i]);
+      }
+      else if (arg == "--frame" && i + 1 < argc)
+      {
+        frame_filepath = argv[++i];
+      }
+      else if (program_filepath.empty() && arg.rfind("--", 0) != 0)
+      {
+        program_filepath = arg;
+      }
+      else
+      {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+    }
+
+    if (program_filepath.empty())
+    {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+    input.program = load_program(program_filepath);
+    if (!keys_filepath.empty())
+    {
+      input.key_script = Chip8::load_key_script(keys_filepath);
+    }
+
+    const Chip8::RunCache cache(cache_directory, checkpoint_interval);
+
+    const auto              start  = std::chrono::steady_clock::now();
+    const Chip8::RunResult result = cache.run(input, cycles);
+    const auto              finish = std::chrono::steady_clock::now();
+
+    std::printf("registers %016llx memory %016llx framebuffer %016llx\n",
+                static_cast<unsigned long long>(result.hash.registers),
+                static_cast<unsigned long long>(result.hash.memory),
+                static_cast<unsigned long long>(result.hash.framebuffer));
+
+    if (result.resumed_from == cycles)
+    {
+      std::cerr << "Cached";
+    }
+    else
+    {
+      std::cerr << "Ran " << cycles - result.resumed_from << " cycles from "
+                << (result.resumed_from ? "a checkpoint at cycle " +
+                                              std::to_string(
+                                                  result.resumed_from)
+                                        : std::string("reset"));
+    }
+    std::cerr << " in "
+              << std::chrono::duration<double>(finish - start).count() *
+                     1000.0
+              << " ms" << std::endl;
+
+    if (!frame_filepath.empty())
+    {
+      write_frame(frame_filepath, result.state.framebuffer);
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
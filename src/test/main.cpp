@@ -0,0 +1,636 @@
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "cpu.hpp"
+#include "debugger.hpp"
+#include "display_delta.hpp"
+#include "explorer.hpp"
+#include "headless_keyboard.hpp"
+#include "interpreter.hpp"
+#include "machine_pool.hpp"
+#include "run_cache.hpp"
+#include "shared_memory.hpp"
+#include "state_hash.hpp"
+#include "vec_env.hpp"
+
+// Headless checks of the core that are quick enough to run on every build.
+// Engines get checked against the interpreter by chip8_lockstep, see
+// CMakeLists.txt.
+
+namespace
+{
+
+uint32_t failures = 0;
+
+#define CHECK(condition)                                                       \
+  do                                                                           \
+  {                                                                            \
+    if (!(condition))                                                          \
+    {                                                                          \
+      std::cerr << __FILE__ << ':' << __LINE__ << ": " #condition " failed"    \
+                << std::endl;                                                  \
+      ++failures;                                                              \
+    }                                                                          \
+  } while (false)
+
+std::string programs_directory;
+
+std::vector<Chip8::byte_t> load_program(const std::string &name)
+{
+  const std::string filepath = programs_directory + "/" + name;
+
+  std::ifstream in(filepath, std::ios::in | std::ios::binary);
+  if (!in)
+  {
+    throw std::runtime_error("Could not open " + filepath);
+  }
+
+  return std::vector<Chip8::byte_t>((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+}
+
+Chip8::CpuState make_start_state(const std::vector<Chip8::byte_t> &program,
+                                 uint64_t                          seed)
+{
+  Chip8::Cpu cpu(std::make_unique<Chip8::HeadlessKeyboard>());
+  cpu.init();
+  cpu.load_program(program);
+
+  Chip8::CpuState state = cpu.get_state();
+  state.random_engine.seed(seed);
+  return state;
+}
+
+std::vector<Chip8::byte_t>
+assemble(const std::vector<Chip8::dbyte_t> &opcodes)
+{
+  std::vector<Chip8::byte_t> program;
+  for (const Chip8::dbyte_t opcode : opcodes)
+  {
+    program.push_back(opcode >> 8);
+    program.push_back(opcode & 0xFF);
+  }
+  return program;
+}
+
+/**
+ * A cpu with a program given as opcodes.
+ */
+std::unique_ptr<Chip8::Cpu> make_cpu(const std::vector<Chip8::dbyte_t> &opcodes)
+{
+  auto cpu = std::make_unique<Chip8::Cpu>(
+      std::make_unique<Chip8::HeadlessKeyboard>());
+  cpu->init();
+  cpu->load_program(assemble(opcodes));
+  return cpu;
+}
+
+/**
+ * The incremental hash has to match a complete one after every instruction.
+ */
+void test_incremental_hash(const std::string &name)
+{
+  Chip8::CpuState         state = make_start_state(load_program(name), 1);
+  Chip8::HeadlessKeyboard keyboard;
+
+  Chip8::IncrementalStateHash hash;
+  hash.reset(state);
+
+  for (uint32_t i = 0; i < 200000 && !state.paused; ++i)
+  {
+    // Some key held down now and then, for the skips and FX0A
+    keyboard.set_keys(i / 5000 % 3 == 0 ? 1 << (i / 15000 % 16) : 0);
+
+    hash.begin(state);
+    Chip8::cycle(state, keyboard);
+    hash.end(state);
+
+    if (hash.get() != Chip8::hash_state(state))
+    {
+      std::cerr << name << ": incremental hash differs after cycle " << i
+                << std::endl;
+      ++failures;
+      return;
+    }
+  }
+}
+
+/**
+ * Replay the keys of a path from the start state on the interpreter.
+ */
+Chip8::CpuState replay(const Chip8::CpuState        &start,
+                       const Chip8::InputPath       &path,
+                       const Chip8::ExplorerOptions &options)
+{
+  Chip8::CpuState         state = start;
+  Chip8::HeadlessKeyboard keyboard;
+
+  for (uint32_t step = 0; step < path.length; ++step)
+  {
+    keyboard.set_keys(1 << path.get_key(step));
+    for (uint32_t i = 0; i < options.frames * options.cycles_per_frame &&
+                         !state.paused;
+         ++i)
+    {
+      Chip8::cycle(state, keyboard);
+    }
+  }
+  return state;
+}
+
+/**
+ * States the explorer visits are computed from compressed parents. They
+ * have to match a replay of their path, and the number of distinct states
+ * may not depend on the number of threads.
+ */
+void test_explorer(const std::string &name)
+{
+  const Chip8::CpuState start = make_start_state(load_program(name), 2);
+
+  Chip8::ExplorerOptions options;
+  options.frames = 20;
+  options.depth  = 3;
+
+  uint64_t unique = 0;
+  for (const uint32_t threads : {1u, 3u})
+  {
+    options.thread_count = threads;
+
+    std::mutex mutex;
+    uint64_t   mismatches = 0;
+
+    Chip8::Explorer explorer(options);
+    const auto      statistics = explorer.run(
+        start,
+        [&](const Chip8::CpuState &state, const Chip8::InputPath &path) {
+          const bool same = Chip8::hash_state(state) ==
+                            Chip8::hash_state(replay(start, path, options));
+          if (!same)
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++mismatches;
+          }
+          return Chip8::Explorer::Visit::Expand;
+        });
+
+    CHECK(mismatches == 0);
+    CHECK(statistics.unique > 1);
+    CHECK(!statistics.truncated);
+    if (threads == 1)
+    {
+      unique = statistics.unique;
+    }
+    CHECK(statistics.unique == unique);
+  }
+}
+
+/**
+ * Remove a cache directory with the state files in it.
+ */
+void remove_directory(const std::string &directory)
+{
+  if (DIR *dir = opendir(directory.c_str()))
+  {
+    while (const dirent *entry = readdir(dir))
+    {
+      const std::string name = entry->d_name;
+      if (name != "." && name != "..")
+      {
+        unlink((directory + "/" + name).c_str());
+      }
+    }
+    closedir(dir);
+  }
+  rmdir(directory.c_str());
+}
+
+/**
+ * Runs have to be found exactly when everything they depend on matches, and
+ * a cached run has to end in the same state as an uncached one.
+ */
+void test_run_cache(const std::string &name)
+{
+  char directory[] = "/tmp/chip8_test_XXXXXX";
+  if (!mkdtemp(directory))
+  {
+    throw std::runtime_error("Could not create a temporary directory");
+  }
+
+  try
+  {
+    const Chip8::RunCache cache(directory, 1000);
+
+    Chip8::RunInput input;
+    input.program    = load_program(name);
+    input.seed       = 3;
+    input.key_script = {{500, 0x0010}, {2500, 0x0000}};
+
+    // Reference without any cache
+    Chip8::CpuState         state = make_start_state(input.program, 3);
+    Chip8::HeadlessKeyboard keyboard;
+    for (uint32_t i = 0; i < 5000; ++i)
+    {
+      keyboard.set_keys(i < 500 ? 0 : i < 2500 ? 0x0010 : 0x0000);
+      Chip8::cycle(state, keyboard);
+    }
+
+    const auto first = cache.run(input, 5000);
+    CHECK(first.resumed_from == 0);
+    CHECK(first.hash == Chip8::hash_state(state));
+
+    const auto again = cache.run(input, 5000);
+    CHECK(again.resumed_from == 5000);
+    CHECK(again.hash == first.hash);
+
+    // A longer run continues from the end of the shorter one
+    const auto longer = cache.run(input, 6000);
+    CHECK(longer.resumed_from == 5000);
+
+    // Keys that only differ after cycle 2500 share the checkpoints up to it
+    Chip8::RunInput later = input;
+    later.key_script.back().keys = 0x0001;
+    const auto branched          = cache.run(later, 5000);
+    CHECK(branched.resumed_from == 2000);
+
+    Chip8::RunInput other_seed = input;
+    other_seed.seed            = 4;
+    CHECK(cache.run(other_seed, 5000).resumed_from == 0);
+
+    Chip8::RunInput other_program = input;
+    other_program.program.push_back(0);
+    CHECK(cache.run(other_program, 5000).resumed_from == 0);
+  }
+  catch (...)
+  {
+    remove_directory(directory);
+    throw;
+  }
+  remove_directory(directory);
+}
+
+/**
+ * run_until() has to stop at the requested events, and only report real
+ * ones.
+ */
+void test_run_until()
+{
+  using Chip8::RunEvent;
+
+  // FX18 with 1 starts a sound that the timer ends in the same cycle
+  auto sound  = make_cpu({0x6001, 0xF018, 0xF00A});
+  auto result =
+      sound->run_until(100, RunEvent::SoundStart | RunEvent::SoundStop);
+  CHECK(result.cycles == 2);
+  CHECK(result.events == (RunEvent::SoundStart | RunEvent::SoundStop));
+
+  // An empty sprite and clearing a clear display change nothing
+  auto draw = make_cpu({
+      0xA300, // I = 0x300, nothing there
+      0xD005, // Draw 5 empty rows
+      0x00E0, // Clear the clear display
+      0xF029, // I = sprite of digit V0
+      0xD005, // Draw it
+      0x00E0, // Clear it again
+      0xF00A, // Wait for a key
+  });
+  result = draw->run_until(100, RunEvent::DisplayChange);
+  CHECK(result.cycles == 5);
+  CHECK(result.events == RunEvent::DisplayChange);
+  CHECK(result.draws == 1);
+
+  result = draw->run_until(100, RunEvent::DisplayChange);
+  CHECK(result.cycles == 1);
+  CHECK(result.events == RunEvent::DisplayChange);
+
+  // Key waits stop the run even if not requested, and right away after
+  result = draw->run_until(100, RunEvent::None);
+  CHECK(result.cycles == 1);
+  CHECK(result.events == RunEvent::KeyWait);
+  CHECK(result.draws == 0);
+
+  result = draw->run_until(100, RunEvent::All);
+  CHECK(result.cycles == 0);
+  CHECK(result.events == RunEvent::KeyWait);
+
+  // Frames end every 10 cycles, also across calls
+  auto frames = make_cpu(std::vector<Chip8::dbyte_t>(40, 0x6000));
+  frames->set_cycles_per_frame(10);
+  result = frames->run_until(25, RunEvent::VBlank);
+  CHECK(result.cycles == 10);
+  CHECK(result.frames == 1);
+  CHECK(result.events == RunEvent::VBlank);
+
+  result = frames->run_until(4, RunEvent::VBlank);
+  CHECK(result.cycles == 4);
+  CHECK(result.events == RunEvent::CycleBudget);
+
+  result = frames->run_until(25, RunEvent::VBlank);
+  CHECK(result.cycles == 6);
+  CHECK(result.events == RunEvent::VBlank);
+}
+
+/**
+ * Machines of a pool start right after loading the program with seeds
+ * counting up, and are handed out once until they are given back.
+ */
+void test_machine_pool(const std::string &name)
+{
+  const auto         program = load_program(name);
+  Chip8::MachinePool pool(program, 2, 10);
+
+  // The hash leaves out the random engine
+  const auto is_start = [&](const Chip8::Machine *machine, uint64_t seed) {
+    const Chip8::CpuState start = make_start_state(program, seed);
+    return Chip8::hash_state(machine->state) == Chip8::hash_state(start) &&
+           machine->state.random_engine == start.random_engine;
+  };
+
+  Chip8::Machine *first  = pool.acquire();
+  Chip8::Machine *second = pool.acquire();
+  CHECK(first && second && first != second);
+  CHECK(pool.acquire() == nullptr);
+  CHECK(pool.get_free_count() == 0);
+
+  // Same as a Cpu that loaded the program with the seed of the machine
+  CHECK(is_start(first, 10));
+  CHECK(is_start(second, 11));
+
+  // Running one leaves the other alone
+  first->keyboard.set_keys(0x0010);
+  first->run(5000);
+  CHECK(!is_start(first, 10));
+  CHECK(is_start(second, 11));
+
+  // The machine released last comes back first, reset with the next seed
+  pool.release(first);
+  CHECK(pool.get_free_count() == 1);
+  Chip8::Machine *again = pool.acquire();
+  CHECK(again == first);
+  CHECK(is_start(again, 12));
+  CHECK(again->keyboard.get_keys() == 0);
+
+  pool.release(again);
+  pool.release(second);
+  CHECK(pool.get_free_count() == 2);
+}
+
+/**
+ * A write gives only the writing machine its own copy of the page, the
+ * others keep seeing the shared image.
+ */
+void test_shared_memory()
+{
+  const auto image = Chip8::make_memory_image(assemble({0x1200}));
+
+  Chip8::SharedMemory writer(image);
+  Chip8::SharedMemory reader(image);
+
+  // Addresses wrap at 4096
+  writer.write(0x1300, 7);
+  CHECK(writer[0x300] == 7);
+  CHECK(reader[0x300] == 0);
+  CHECK(writer.get_owned_page_count() == 1);
+  CHECK(reader.get_owned_page_count() == 0);
+
+  // The rest of the copied page stays as in the image
+  CHECK(writer[0x200] == 0x12 && writer[0x301] == 0);
+
+  writer.reset();
+  CHECK(writer[0x300] == 0);
+  CHECK(writer.get_owned_page_count() == 0);
+
+  // Only a machine that holds key 1 stores 7 at 0x300. Every machine then
+  // draws the digit it finds there.
+  const auto program = assemble({
+      0x6001, // V0 = 1
+      0x6107, // V1 = 7
+      0xA300, //
+      0xE0A1, // Key 1 held?
+      0xF133, // Then 0x300 to 0x302 = 0, 0, 7
+      0xF265, // V0 to V2 = 0x300 to 0x302
+      0xF229, // I = sprite of digit V2
+      0xD005, // Draw it at (V0, V0)
+      0xF00A, // Wait for a key
+  });
+
+  Chip8::VecEnv env(program, 3, 20, 1);
+  const size_t  usage = env.get_memory_usage();
+
+  const std::array<uint16_t, 3> actions = {0x0000, 0x0002, 0x0000};
+  env.step(actions.data());
+
+  const auto framebuffer = [&](uint32_t index) {
+    return reinterpret_cast<const Chip8::Framebuffer *>(
+        env.get_framebuffers() + index * env.get_framebuffer_stride());
+  };
+
+  // Second row of 0 is 1001, of 7 0001
+  CHECK((*framebuffer(0))[1][0] == 1);
+  CHECK((*framebuffer(1))[1][0] == 0 && (*framebuffer(1))[1][3] == 1);
+  CHECK((*framebuffer(2))[1][0] == 1);
+  CHECK(env.get_memory_usage() == usage + Chip8::SharedMemory::page_size);
+
+  env.reset(1);
+  CHECK(env.get_memory_usage() == usage);
+  CHECK(*framebuffer(1) == Chip8::Framebuffer{});
+
+  // After the reset the machine reads the shared 0 again
+  const std::array<uint16_t, 3> none = {};
+  env.step(none.data());
+  CHECK((*framebuffer(1))[1][0] == 1);
+}
+
+/**
+ * The debugger has to stop right after the instruction that accessed a
+ * watched byte or made a condition true, and before a breakpoint.
+ */
+void test_debugger()
+{
+  using Reason = Chip8::Debugger::StopReason;
+
+  const std::vector<Chip8::dbyte_t> program = {
+      0x6003, // 200: V0 = 3
+      0xA300, // 202: I = 0x300
+      0xF033, // 204: Write 0x300 to 0x302
+      0xF065, // 206: Read 0x300 into V0
+      0x7101, // 208: V1 = 1
+      0x7101, // 20A: V1 = 2
+      0x7101, // 20C: V1 = 3
+      0x7101, // 20E: V1 = 4
+      0x6103, // 210: V1 = 3 again
+      0x6103, // 212: Still 3
+      0xF00A, // 214: Wait for a key
+  };
+
+  // Attach a new debugger to a new cpu
+  std::unique_ptr<Chip8::Cpu> cpu;
+  Chip8::Debugger            *debugger = nullptr;
+
+  const auto restart = [&]() {
+    auto engine = std::make_unique<Chip8::Debugger>();
+    debugger    = engine.get();
+    cpu         = make_cpu(program);
+    cpu->set_engine(std::move(engine));
+  };
+
+  restart();
+
+  // Stopped from the start, nothing runs
+  cpu->run(100);
+  CHECK(cpu->get_state().pc_register == 0x200);
+
+  debugger->set_watchpoint(0x302, 1, Chip8::Debugger::watch_write);
+  debugger->resume();
+  cpu->run(100);
+  CHECK(debugger->get_stop_reason() == Reason::WriteWatchpoint);
+  CHECK(cpu->get_state().pc_register == 0x206);
+  CHECK(debugger->describe_stop() ==
+        "Write watchpoint at 0x302 by the instruction at 0x204");
+
+  // A read watchpoint ignores the write before
+  debugger->set_watchpoint(0x302, 1, 0);
+  debugger->set_watchpoint(0x300, 1, Chip8::Debugger::watch_read);
+  debugger->resume();
+  cpu->run(100);
+  CHECK(debugger->get_stop_reason() == Reason::ReadWatchpoint);
+  CHECK(cpu->get_state().pc_register == 0x208);
+
+  // A condition stops when it turns true, not while it stays true
+  debugger->add_condition(Chip8::parse_register_condition("V1 == 3"));
+  for (const Chip8::dbyte_t pc : {0x20E, 0x212})
+  {
+    debugger->resume();
+    cpu->run(100);
+    CHECK(debugger->get_stop_reason() == Reason::Condition);
+    CHECK(cpu->get_state().pc_register == pc);
+    CHECK(cpu->get_state().v_registers[1] == 3);
+  }
+
+  debugger->resume();
+  cpu->run(100);
+  CHECK(!debugger->is_stopped());
+  CHECK(cpu->is_paused());
+
+  // Breakpoints stop before the instruction, once per resume
+  restart();
+  debugger->set_breakpoint(0x20A, true);
+  debugger->resume();
+  cpu->run(100);
+  CHECK(debugger->get_stop_reason() == Reason::Breakpoint);
+  CHECK(cpu->get_state().pc_register == 0x20A);
+  CHECK(cpu->get_state().v_registers[1] == 1);
+
+  debugger->resume();
+  cpu->run(100);
+  CHECK(!debugger->is_stopped());
+  CHECK(cpu->get_state().v_registers[1] == 3);
+}
+
+/**
+ * Frames of the server, decoded by a client, have to reproduce the display
+ * exactly, and malformed ones have to be refused.
+ */
+void test_display_delta()
+{
+  Chip8::Framebuffer   known{};
+  Chip8::Framebuffer   display{};
+  std::vector<uint8_t> out;
+
+  // Row 3 with pixels 3 to 5 lit: 3 unchanged, then 3 changed
+  display[3][3] = display[3][4] = display[3][5] = 1;
+  Chip8::encode_display_delta(known, display, out);
+  CHECK((out == std::vector<uint8_t>{3, 2, 3, 3}));
+  CHECK(known == display);
+
+  Chip8::Framebuffer client{};
+  CHECK(Chip8::decode_display_delta(out.data(), out.size(), client));
+  CHECK(client == display);
+
+  // Nothing changed, nothing sent
+  out.clear();
+  Chip8::encode_display_delta(known, display, out);
+  CHECK(out.empty());
+
+  // Random changes, including runs that touch both edges
+  std::mt19937 random(5);
+  for (uint32_t frame = 0; frame < 200; ++frame)
+  {
+    for (uint32_t flip = random() % 40; flip > 0; --flip)
+    {
+      display[random() % Chip8::display_height]
+             [random() % Chip8::display_width] ^= 1;
+    }
+    if (frame % 50 == 0)
+    {
+      display[frame % Chip8::display_height].fill(1);
+    }
+
+    out.clear();
+    Chip8::encode_display_delta(known, display, out);
+    CHECK(known == display);
+    CHECK(Chip8::decode_display_delta(out.data(), out.size(), client));
+    CHECK(client == display);
+  }
+
+  Chip8::Framebuffer ignored{};
+  const std::vector<std::vector<uint8_t>> malformed = {
+      {32, 0},        // No such row
+      {0, 2, 60, 5},  // Past the end of the row
+      {0, 3, 1, 2},   // Runs missing
+      {0},            // Run count missing
+  };
+  for (const auto &rows : malformed)
+  {
+    CHECK(!Chip8::decode_display_delta(rows.data(), rows.size(), ignored));
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " PROGRAMS_DIRECTORY" << std::endl;
+    return EXIT_FAILURE;
+  }
+  programs_directory = argv[1];
+
+  try
+  {
+    for (const char *name : {"blinky.bin", "blitz.bin", "pc_wrap.bin"})
+    {
+      test_incremental_hash(name);
+      test_explorer(name);
+    }
+    test_run_cache("blinky.bin");
+    test_display_delta();
+    test_run_until();
+    test_machine_pool("blinky.bin");
+    test_shared_memory();
+    test_debugger();
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (failures > 0)
+  {
+    std::cerr << failures << " checks failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "All checks passed" << std::endl;
+  return EXIT_SUCCESS;
+}
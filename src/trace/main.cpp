@@ -0,0 +1,350 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cpu.hpp"
+#include "disassembler.hpp"
+#include "headless_keyboard.hpp"
+#include "key_script.hpp"
+#include "trace.hpp"
+
+void print_usage(const char *program_name)
+{
+  std::cerr << "Usage: " << program_name
+            << " record [OPTIONS] PROGRAM_FILEPATH TRACE_FILEPATH" << std::endl
+            << "       " << program_name
+            << " show [OPTIONS] TRACE_FILEPATH" << std::endl
+            << std::endl
+            << "Record the instructions a program executes headless, or print "
+               "a trace written"
+            << std::endl
+            << "by chip8 --trace or by record." << std::endl
+            << std::endl
+            << "Record options:" << std::endl
+            << "  --cycles N          Cycles to run (default 10000000)"
+            << std::endl
+            << "  --keys FILEPATH     Key script with lines of "
+               "\"CYCLE KEY_MASK\", the mask"
+            << std::endl
+            << "                      in hex with bit N for key N" << std::endl
+            << std::endl
+            << "Show options:" << std::endl
+            << "  --from N            Skip instructions before number N"
+            << std::endl
+            << "  --to N              Stop after instruction number N"
+            << std::endl
+            << "  --pc ADDRESS        Only instructions at ADDRESS, in hex"
+            << std::endl
+            << "  --opcode PATTERN    Only opcodes matching PATTERN, 4 hex "
+               "digits where . matches"
+            << std::endl
+            << "                      any digit, e.g. D... or F.33"
+            << std::endl
+            << "  --register X        Only instructions that write VX, X in "
+               "hex"
+            << std::endl;
+}
+
+std::vector<Chip8::byte_t> load_program(const std::string &filepath)
+{
+  std::ifstream in(filepath, std::ios::in | std::ios::binary);
+  if (!in)
+  {
+    throw std::runtime_error("Could not open " + filepath);
+  }
+
+  return std::vector<Chip8::byte_t>((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+}
+
+/**
+ * Run the program the same way twice, without and with tracing, and report
+ * the cost of tracing per instruction.
+ */
+int record(const std::string                  &program_filepath,
+           const std::string                  &trace_filepath,
+           uint64_t                            cycles,
+           const std::vector<Chip8::KeyEvent> &key_script)
+{
+  const auto program = load_program(program_filepath);
+
+  uint64_t records = 0;
+
+  const auto run = [&](std::unique_ptr<Chip8::Tracer> tracer) {
+    auto  new_keyboard = std::make_unique<Chip8::HeadlessKeyboard>();
+    auto *keyboard     = new_keyboard.get();
+
+    Chip8::Cpu cpu(std::move(new_keyboard));
+    cpu.init();
+    cpu.load_program(program);
+
+    // Same random numbers in both runs
+    Chip8::CpuState state = cpu.get_state();
+    state.random_engine.seed(0);
+    cpu.set_state(state);
+    cpu.set_tracer(std::move(tracer));
+
+    size_t next_key_event = 0;
+
+    // Stop at a key wait as well, the cost is per executed instruction
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t cycle = 0; cycle < cycles && !cpu.is_paused(); ++cycle)
+    {
+      while (next_key_event < key_script.size() &&
+             key_script[next_key_event].cycle <= cycle)
+      {
+        keyboard->set_keys(key_script[next_key_event++].keys);
+      }
+      cpu.cycle();
+    }
+    const auto finish = std::chrono::steady_clock::now();
+
+    if (cpu.get_tracer())
+    {
+      cpu.get_tracer()->stop();
+      records = cpu.get_tracer()->get_written_records();
+    }
+
+    return std::chrono::duration<double>(finish - start).count();
+  };
+
+  const double plain_time  = run(nullptr);
+  const double traced_time =
+      run(std::make_unique<Chip8::Tracer>(trace_filepath));
+
+  std::cout << records << " instructions traced to " << trace_filepath
+            << std::endl;
+  if (records > 0)
+  {
+    std::cout << plain_time / records * 1e9 << " ns per instruction without "
+              << "tracing, " << traced_time / records * 1e9 << " ns with, "
+              << (traced_time - plain_time) / records * 1e9
+              << " ns per traced instruction" << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Opcode filter of the form D... or F.33.
+ */
+struct OpcodePattern
+{
+  Chip8::dbyte_t mask  = 0;
+  Chip8::dbyte_t value = 0;
+};
+
+OpcodePattern parse_opcode_pattern(const std::string &pattern)
+{
+  if (pattern.size() != 4)
+  {
+    throw std::runtime_error("Opcode pattern needs 4 digits: " + pattern);
+  }
+
+  OpcodePattern result;
+  for (const char digit : pattern)
+  {
+    result.mask <<= 4;
+    result.value <<= 4;
+
+    if (digit != '.')
+    {
+      result.mask |= 0xF;
+      result.value |= std::stoul(std::string(1, digit), nullptr, 16);
+    }
+  }
+  return result;
+}
+
+struct Filter
+{
+  uint64_t      from    = 0;
+  uint64_t      to      = UINT64_MAX;
+  int32_t       pc      = -1;
+  int32_t       changed = -1;
+  OpcodePattern opcode{};
+};
+
+int show(const std::string &trace_filepath, const Filter &filter)
+{
+  std::ifstream in(trace_filepath, std::ios::in | std::ios::binary);
+  if (!in)
+  {
+    throw std::runtime_error("Could not open " + trace_filepath);
+  }
+
+  Chip8::TraceHeader header;
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      !header.is_compatible())
+  {
+    throw std::runtime_error(trace_filepath + " is no trace of this version");
+  }
+
+  std::printf("%10s  %-5s  %-4s  %-20s %-5s  %-2s %-2s  %s\n", "number", "pc",
+              "op", "instruction", "i", "dt", "st", "changes");
+
+  // Numbers are stored with 32 bits, count the wrap arounds
+  uint64_t epoch = 0;
+  uint32_t last  = 0;
+
+  std::vector<Chip8::TraceRecord> records(4096);
+  while (in.read(reinterpret_cast<char *>(records.data()),
+                 records.size() * sizeof(Chip8::TraceRecord)) ||
+         in.gcount() > 0)
+  {
+    const size_t count = in.gcount() / sizeof(Chip8::TraceRecord);
+
+    for (size_t n = 0; n < count; ++n)
+    {
+      const Chip8::TraceRecord &record = records[n];
+
+      if (record.cycle < last)
+      {
+        epoch += uint64_t(1) << 32;
+      }
+      last = record.cycle;
+
+      const uint64_t number = epoch + record.cycle;
+      if (number > filter.to)
+      {
+        return EXIT_SUCCESS;
+      }
+      if (number < filter.from ||
+          (filter.pc >= 0 && record.pc != filter.pc) ||
+          (record.opcode & filter.opcode.mask) != filter.opcode.value ||
+          (filter.changed >= 0 &&
+           !(Chip8::written_registers(record.opcode) >> filter.changed & 1)))
+      {
+        continue;
+      }
+
+      // Only VX and VF are stored, other written registers get listed
+      const uint32_t written = Chip8::written_registers(record.opcode);
+      const int      x       = (record.opcode >> 8) & 0xF;
+
+      std::string changes;
+      char        text[16];
+      for (int reg = 0; reg < 16; ++reg)
+      {
+        if (!(written >> reg & 1))
+        {
+          continue;
+        }
+        if (reg == x || reg == 0xF)
+        {
+          std::snprintf(text, sizeof(text), "V%X=%02X ", reg,
+                        reg == x ? record.vx : record.vf);
+        }
+        else
+        {
+          std::snprintf(text, sizeof(text), "V%X ", reg);
+        }
+        changes += text;
+      }
+      if (record.paused)
+      {
+        changes += "paused";
+      }
+
+      std::printf("%10llu  0x%03X  %04X  %-20s 0x%03X  %02X %02X  %s\n",
+                  static_cast<unsigned long long>(number), record.pc,
+                  record.opcode, Chip8::disassemble(record.opcode).c_str(),
+                  record.i_register, record.timer_delay, record.timer_sound,
+                  changes.c_str());
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    print_usage(argv[0]);
+    std::exit(EXIT_FAILURE);
+  }
+
+  const std::string command = argv[1];
+
+  std::string              keys_filepath;
+  uint64_t                 cycles = 10000000;
+  Filter                   filter;
+  std::vector<std::string> filepaths;
+
+  try
+  {
+    for (int i = 2; i < argc; ++i)
+    {
+      const std::string arg = argv[i];
+
+      if (arg == "--cycles" && i + 1 < argc)
+      {
+        cycles = std::stoull(argv[++i]);
+      }
+      else if (arg == "--keys" && i + 1 < argc)
+      {
+        keys_filepath = argv[++i];
+      }
+      else if (arg == "--from" && i + 1 < argc)
+      {
+        filter.from = std::stoull(argv[++i]);
+      }
+      else if (arg == "--to" && i + 1 < argc)
+      {
+        filter.to = std::stoull(argv[++i]);
+      }
+      else if (arg == "--pc" && i + 1 < argc)
+      {
+        filter.pc = std::stoul(argv[++i], nullptr, 16);
+      }
+      else if (arg == "--opcode" && i + 1 < argc)
+      {
+        filter.opcode = parse_opcode_pattern(argv[++i]);
+      }
+      else if (arg == "--register" && i + 1 < argc)
+      {
+        filter.changed = std::stoul(argv[++i], nullptr, 16) & 0xF;
+      }
+      else if (arg.rfind("--", 0) != 0)
+      {
+        filepaths.push_back(arg);
+      }
+      else
+      {
+        print_usage(argv[0]);
+        std::exit(EXIT_FAILURE);
+      }
+    }
+
+    if (command == "record" && filepaths.size() == 2)
+    {
+      std::vector<Chip8::KeyEvent> key_script;
+      if (!keys_filepath.empty())
+      {
+        key_script = Chip8::load_key_script(keys_filepath);
+      }
+      return record(filepaths[0], filepaths[1], cycles, key_script);
+    }
+
+    if (command == "show" && filepaths.size() == 1)
+    {
+      return show(filepaths[0], filter);
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  print_usage(argv[0]);
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,171 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "glfw_window.hpp"
+#include "vec_env.hpp"
+#include "wall_renderer.hpp"
+
+void print_usage(const char *program_name)
+{
+  std::cerr << "Usage: " << program_name << " [OPTIONS] PROGRAM_FILEPATH"
+            << std::endl
+            << std::endl
+            << "Run many instances of a program as a batch and show all of "
+               "them in one window."
+            << std::endl
+            << std::endl
+            << "Options:" << std::endl
+            << "  --instances N       Number of instances (default 256)"
+            << std::endl
+            << "  --cycles N          Cycles per instance and frame "
+               "(default 10)"
+            << std::endl
+            << "  --threads N         Threads to step with (default one per "
+               "core)"
+            << std::endl
+            << "  --seed N            Seed of the random numbers and keys "
+               "(default 0)"
+            << std::endl
+            << "  --no-keys           Press no keys, by default every "
+               "instance presses random keys"
+            << std::endl;
+}
+
+std::vector<Chip8::byte_t> load_program(const std::string &filepath)
+{
+  std::ifstream in(filepath, std::ios::in | std::ios::binary);
+  if (!in)
+  {
+    throw std::runtime_error("Could not open " + filepath);
+  }
+
+  return std::vector<Chip8::byte_t>((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t    instances = 256;
+  uint32_t    cycles    = 10;
+  uint32_t    threads   = 0;
+  uint64_t    seed      = 0;
+  bool        keys      = true;
+  std::string program_filepath;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+
+    if (arg == "--instances" && i + 1 < argc)
+    {
+      instances = std::stoul(argv[++i]);
+    }
+    else if (arg == "--cycles" && i + 1 < argc)
+    {
+      cycles = std::stoul(argv[++i]);
+    }
+    else if (arg == "--threads" && i + 1 < argc)
+    {
+      threads = std::stoul(argv[++i]);
+    }
+    else if (arg == "--seed" && i + 1 < argc)
+    {
+      seed = std::stoull(argv[++i]);
+    }
+    else if (arg == "--no-keys")
+    {
+      keys = false;
+    }
+    else if (program_filepath.empty() && arg.rfind("--", 0) != 0)
+    {
+      program_filepath = arg;
+    }
+    else
+    {
+      print_usage(argv[0]);
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  if (program_filepath.empty() || instances == 0)
+  {
+    print_usage(argv[0]);
+    std::exit(EXIT_FAILURE);
+  }
+
+  try
+  {
+    Chip8::VecEnv env(load_program(program_filepath), instances, cycles,
+                      threads, seed);
+
+    auto window = std::make_shared<Chip8::GlfwWindow>();
+
+    Chip8::WallRenderer renderer(window, instances);
+    renderer.create_window();
+
+    // Every instance holds a random key, or none, for a while
+    std::vector<uint16_t>                   actions(instances);
+    std::default_random_engine              random_engine(seed);
+    std::uniform_int_distribution<uint32_t> key_distribution(0, 16);
+    std::uniform_int_distribution<uint32_t> change_distribution(0, 15);
+
+    double render_time = 0.0;
+
+    while (!window->is_closed())
+    {
+      if (keys)
+      {
+        for (auto &action : actions)
+        {
+          if (change_distribution(random_engine) == 0)
+          {
+            const uint32_t key = key_distribution(random_engine);
+            action             = key < 16 ? 1 << key : 0;
+          }
+        }
+      }
+      env.step(actions.data());
+
+      const auto start = std::chrono::steady_clock::now();
+      renderer.render(env.get_framebuffers(), env.get_framebuffer_stride(),
+                      env.get_dirty_rows());
+      env.clear_dirty_rows();
+      render_time += std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+      window->flush();
+    }
+
+    const auto &statistics = renderer.get_statistics();
+    if (statistics.frames > 0)
+    {
+      std::cerr << "Wall: " << statistics.frames << " frames, "
+                << double(statistics.changed_rows) / statistics.frames
+                << " changed rows in "
+                << double(statistics.uploads) / statistics.frames
+                << " uploads per frame, "
+                << render_time / statistics.frames * 1000000.0
+                << " us per frame to upload and draw " << instances
+                << " instances" << std::endl;
+    }
+
+    renderer.terminate();
+    window->terminate();
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}